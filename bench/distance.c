@@ -0,0 +1,112 @@
+// distance.c
+// benchmark of the air distance kernels against the scalar haversine_distance: accuracy and distances per second
+//
+// usage: ./bench_distance /path/to/my/file.bin [nr_of_distances]
+//
+// the distances are computed like in the search: batches of DISTANCE_BATCH random nodes to one random target
+
+
+#include "../src/astar.h"
+
+static uint64_t next_random(uint64_t* state)
+{
+    // xorshift64, fixed seed so every run computes the same distances
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static void run_kernel(const char* name, DistanceKernel kernel, Graph* graph, uint32_t* indices,
+        uint32_t* targets, unsigned long nr_of_batches, double* reference)
+{
+    // times the kernel over all batches and compares its results with the haversine distances
+    double distances[DISTANCE_BATCH];
+    double max_error = 0, max_relative_error = 0, error, sum = 0;
+    struct timespec start, end;
+    double milliseconds;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (unsigned long b = 0; b<nr_of_batches; ++b) {
+        kernel(graph, indices+b*DISTANCE_BATCH, DISTANCE_BATCH, targets[b], distances);
+        sum += distances[b%DISTANCE_BATCH];
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    milliseconds = elapsed_milliseconds(start, end);
+
+    for (unsigned long b = 0; b<nr_of_batches; ++b) {
+        kernel(graph, indices+b*DISTANCE_BATCH, DISTANCE_BATCH, targets[b], distances);
+        for (unsigned long i = 0; i<DISTANCE_BATCH; ++i) {
+            error = fabs(distances[i]-reference[b*DISTANCE_BATCH+i]);
+            if (error>max_error) max_error = error;
+            if (reference[b*DISTANCE_BATCH+i]>1 && error/reference[b*DISTANCE_BATCH+i]>max_relative_error)
+                max_relative_error = error/reference[b*DISTANCE_BATCH+i];
+        }
+    }
+    printf("%-10s %8.1f ms %8.1f million distances/s   max error %.2e m, relative %.2e   (checksum %.0f)\n", name,
+            milliseconds, nr_of_batches*DISTANCE_BATCH/milliseconds/1000.0, max_error, max_relative_error, sum);
+}
+
+int main(int argc, char* argv[])
+{
+    Graph graph;
+    int code;
+    unsigned long nr_of_distances = 10000000;
+    unsigned long nr_of_batches;
+    uint32_t* indices;
+    uint32_t* targets;
+    double* reference;
+    uint64_t state = 88172645463325252ULL;
+    double sum = 0;
+    struct timespec start, end;
+    double milliseconds;
+
+    if (argc<2) {
+        printf("Usage: ./bench_distance file.bin [nr_of_distances]\n");
+        exit(1);
+    }
+    if (argc>2) nr_of_distances = strtoul(argv[2], NULL, 10);
+    if ((code = read_binary_file(argv[1], &graph))!=0) exit(code);
+    if (graph.nr_of_nodes==0) exit(1);
+
+    nr_of_batches = (nr_of_distances+DISTANCE_BATCH-1)/DISTANCE_BATCH;
+    indices = malloc(nr_of_batches*DISTANCE_BATCH*sizeof(uint32_t));
+    targets = malloc(nr_of_batches*sizeof(uint32_t));
+    reference = malloc(nr_of_batches*DISTANCE_BATCH*sizeof(double));
+    if (indices==NULL || targets==NULL || reference==NULL) exit(1);
+    for (unsigned long b = 0; b<nr_of_batches; ++b) {
+        targets[b] = (uint32_t) (next_random(&state)%graph.nr_of_nodes);
+        for (unsigned long i = 0; i<DISTANCE_BATCH; ++i) {
+            indices[b*DISTANCE_BATCH+i] = (uint32_t) (next_random(&state)%graph.nr_of_nodes);
+        }
+    }
+
+    // the scalar function with libm calls is the reference
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (unsigned long b = 0; b<nr_of_batches; ++b) {
+        for (unsigned long i = 0; i<DISTANCE_BATCH; ++i) {
+            reference[b*DISTANCE_BATCH+i] = haversine_distance(indices[b*DISTANCE_BATCH+i], targets[b], &graph);
+        }
+        sum += reference[b*DISTANCE_BATCH+b%DISTANCE_BATCH];
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    milliseconds = elapsed_milliseconds(start, end);
+
+    printf("%lu nodes, %lu distances in batches of %d\n", graph.nr_of_nodes, nr_of_batches*DISTANCE_BATCH,
+            DISTANCE_BATCH);
+    printf("%-10s %8.1f ms %8.1f million distances/s   (checksum %.0f)\n", "haversine", milliseconds,
+            nr_of_batches*DISTANCE_BATCH/milliseconds/1000.0, sum);
+    run_kernel("scalar", chord_distances_scalar, &graph, indices, targets, nr_of_batches, reference);
+#if defined(__x86_64__)
+    run_kernel("sse2", chord_distances_sse2, &graph, indices, targets, nr_of_batches, reference);
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        run_kernel("avx2", chord_distances_avx2, &graph, indices, targets, nr_of_batches, reference);
+    }
+#endif
+
+    free(indices);
+    free(targets);
+    free(reference);
+    free_graph(&graph);
+    return 0;
+}
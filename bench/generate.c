@@ -0,0 +1,140 @@
+// generate.c
+// deterministic synthetic road network in the .csv format of the parser, for benchmarks without the real extracts
+//
+// usage: ./bench_generate /path/to/my/file.csv width height [oneway_ratio] [seed]
+//
+// the nodes form a width x height grid of blocks of about 100 m around Madrid with jittered coordinates and
+// ascending ids with gaps, like the nodes of an OpenStreetMap extract
+// every row and column is a street cut into ways of a few blocks, every 10th one is a two-way primary road,
+// the other ways are oneway with oneway_ratio (in a random direction) and some blocks are missing
+// a few diagonal ways connect opposite corners of blocks, so the graph is not a plain grid
+// the same arguments always write the same file
+
+
+#include "../src/astar.h"
+
+#define GRID_LAT 40.40 // south-west corner of the grid
+#define GRID_LON -3.70
+#define GRID_STEP 0.0009 // degrees of latitude per block, about 100 m
+#define GRID_JITTER 0.3 // largest shift of a node in blocks
+#define GRID_MISSING 0.03 // share of the blocks of a street which have no road
+#define GRID_ARTERIAL 10 // every 10th row and column is a primary road
+#define GRID_MAX_WAY 12 // blocks per way at most
+
+static uint64_t next_random(uint64_t* state)
+{
+    // xorshift64, the seed alone decides the graph
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static double next_uniform(uint64_t* state)
+{
+    // uniform in [0, 1)
+    return (next_random(state) >> 11)*(1.0/9007199254740992.0);
+}
+
+static void write_way(FILE* fout, unsigned long* way_id, uint64_t* ids, unsigned long* members,
+        unsigned long nr_of_members, bool arterial, double oneway_ratio, uint64_t* state)
+{
+    // writes one way along the member indices, a oneway way runs forwards or backwards
+    // way|id|name|highway|route|ref|?|oneway|maxspeed|member|member|...
+
+    bool oneway = !arterial && next_uniform(state)<oneway_ratio;
+    bool backwards = oneway && (next_random(state) & 1);
+
+    fprintf(fout, "way|%lu|Street %lu|%s||||%s|%d", *way_id, *way_id, arterial ? "primary" : "residential",
+            oneway ? "oneway" : "", arterial ? 80 : 50);
+    for (unsigned long i = 0; i<nr_of_members; ++i) {
+        fprintf(fout, "|%lu", (unsigned long) ids[members[backwards ? nr_of_members-1-i : i]]);
+    }
+    fputc('\n', fout);
+    (*way_id)++;
+}
+
+static void write_street(FILE* fout, unsigned long* way_id, uint64_t* ids, unsigned long first, unsigned long stride,
+        unsigned long length, bool arterial, double oneway_ratio, uint64_t* state, unsigned long* members)
+{
+    // cuts the street of length nodes (first, first+stride, ...) into ways of a few blocks,
+    // a way ends where the next one starts unless the block between them is missing
+    unsigned long nr_of_members = 0;
+    unsigned long way_length = 1+next_random(state)%GRID_MAX_WAY;
+
+    for (unsigned long i = 0; i<length; ++i) {
+        members[nr_of_members++] = first+i*stride;
+        if (i+1==length || (!arterial && next_uniform(state)<GRID_MISSING)) {
+            if (nr_of_members>1) write_way(fout, way_id, ids, members, nr_of_members, arterial, oneway_ratio, state);
+            nr_of_members = 0;
+            way_length = 1+next_random(state)%GRID_MAX_WAY;
+        }
+        else if (nr_of_members>way_length) {
+            write_way(fout, way_id, ids, members, nr_of_members, arterial, oneway_ratio, state);
+            members[0] = first+i*stride;
+            nr_of_members = 1;
+            way_length = 1+next_random(state)%GRID_MAX_WAY;
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned long width, height, n;
+    double oneway_ratio = 0.2;
+    uint64_t state = 88172645463325252ULL;
+    uint64_t* ids;
+    unsigned long* members;
+    unsigned long way_id = 1;
+    unsigned long corner;
+    double lon_step;
+    FILE* fout;
+
+    if (argc<4) {
+        printf("Usage: ./bench_generate file.csv width height [oneway_ratio] [seed]\n");
+        exit(1);
+    }
+    width = strtoul(argv[2], NULL, 10);
+    height = strtoul(argv[3], NULL, 10);
+    if (argc>4) oneway_ratio = strtod(argv[4], NULL);
+    if (argc>5) state ^= strtoull(argv[5], NULL, 10)*0x9E3779B97F4A7C15ULL;
+    if (state==0) state = 88172645463325252ULL;
+    if (width<2 || height<2 || width*height>=NO_PARENT-1) exit(1);
+    n = width*height;
+    ids = malloc(n*sizeof(uint64_t));
+    members = malloc((width>height ? width : height)*sizeof(unsigned long));
+    if (ids==NULL || members==NULL) exit(1);
+    if ((fout = fopen(argv[1], "w"))==NULL) exit(31);
+
+    // the parser skips three header lines and expects the nodes sorted by id
+    fprintf(fout, "# synthetic road network %lu x %lu, oneway ratio %.2f\n# nodes\n# ways\n", width, height,
+            oneway_ratio);
+    lon_step = GRID_STEP/cos(GRID_LAT*M_PI/180);
+    for (unsigned long i = 0; i<n; ++i) {
+        ids[i] = (i==0 ? 100000000 : ids[i-1])+1+next_random(&state)%8;
+        fprintf(fout, "node|%lu||||||||%.7f|%.7f\n", (unsigned long) ids[i],
+                GRID_LAT+(i/width+GRID_JITTER*(2*next_uniform(&state)-1))*GRID_STEP,
+                GRID_LON+(i%width+GRID_JITTER*(2*next_uniform(&state)-1))*lon_step);
+    }
+
+    for (unsigned long row = 0; row<height; ++row) {
+        write_street(fout, &way_id, ids, row*width, 1, width, row%GRID_ARTERIAL==0, oneway_ratio, &state, members);
+    }
+    for (unsigned long column = 0; column<width; ++column) {
+        write_street(fout, &way_id, ids, column, width, height, column%GRID_ARTERIAL==0, oneway_ratio, &state,
+                members);
+    }
+    for (unsigned long i = 0; i<n/50; ++i) {
+        corner = (next_random(&state)%(height-1))*width+next_random(&state)%(width-1);
+        members[0] = corner;
+        members[1] = corner+width+1;
+        write_way(fout, &way_id, ids, members, 2, false, oneway_ratio, &state);
+    }
+    fprintf(fout, "relation|1|synthetic\n");
+
+    fclose(fout);
+    fprintf(stderr, "%lu nodes and %lu ways written to %s\n", n, way_id-1, argv[1]);
+    free(members);
+    free(ids);
+    return 0;
+}
@@ -0,0 +1,78 @@
+// id_lookup.c
+// benchmark of the id lookup: the hash table of the .bin (id index) against the binary search on the sorted ids
+//
+// usage: ./bench_id_lookup /path/to/my/file.bin [nr_of_lookups]
+//
+// looks up the same pseudo random ids (nine of ten exist, like the way members of a .csv) with both methods
+// and prints the time per lookup, exits with 1 if the two methods disagree
+
+
+#include "../src/astar.h"
+
+static uint64_t next_random(uint64_t* state)
+{
+    // xorshift64, fixed seed so every run looks up the same ids
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+int main(int argc, char* argv[])
+{
+    Graph graph;
+    int code;
+    unsigned long nr_of_lookups = 10000000;
+    unsigned long* ids;
+    unsigned long* results;
+    uint64_t state = 88172645463325252ULL;
+    struct timespec start, end;
+    double sorted_milliseconds, index_milliseconds;
+
+    if (argc<2) {
+        printf("Usage: ./bench_id_lookup file.bin [nr_of_lookups]\n");
+        exit(1);
+    }
+    if (argc>2) nr_of_lookups = strtoul(argv[2], NULL, 10);
+    if ((code = read_binary_file(argv[1], &graph))!=0) exit(code);
+    if (graph.nr_of_nodes==0) exit(1);
+    if (!graph.ids_sorted) {
+        printf("The ids of %s are not in ascending order, there are no sorted ids to search.\n", argv[1]);
+        exit(1);
+    }
+
+    ids = malloc(nr_of_lookups*sizeof(unsigned long));
+    results = malloc(nr_of_lookups*sizeof(unsigned long));
+    if (ids==NULL || results==NULL) exit(1);
+    for (unsigned long i = 0; i<nr_of_lookups; ++i) {
+        ids[i] = graph.ids[next_random(&state)%graph.nr_of_nodes];
+        if (next_random(&state)%10==0) ids[i] += 1; // mostly an id which does not exist
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (unsigned long i = 0; i<nr_of_lookups; ++i) {
+        results[i] = search_sorted_ids(&graph, ids[i]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    sorted_milliseconds = elapsed_milliseconds(start, end);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (unsigned long i = 0; i<nr_of_lookups; ++i) {
+        if (search_id_index(&graph, ids[i])!=results[i]) {
+            printf("Mismatch for id %lu.\n", ids[i]);
+            exit(1);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    index_milliseconds = elapsed_milliseconds(start, end);
+
+    printf("%lu nodes, %lu lookups\n", graph.nr_of_nodes, nr_of_lookups);
+    printf("binary search: %.1f ns/lookup\n", 1e6*sorted_milliseconds/nr_of_lookups);
+    printf("id index:      %.1f ns/lookup (%.1fx)\n", 1e6*index_milliseconds/nr_of_lookups,
+            sorted_milliseconds/index_milliseconds);
+
+    free(ids);
+    free(results);
+    free_graph(&graph);
+    return 0;
+}
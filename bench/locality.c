@@ -0,0 +1,72 @@
+// locality.c
+// benchmark of the memory layout of a graph: settled nodes per second of bounded one-to-all searches
+//
+// usage: ./bench_locality /path/to/my/file.bin [nr_of_searches] [max_distance_in_metres]
+//
+// the sources are chosen by id, so a .bin converted with another node order (-O) searches from the same
+// places and the numbers can be compared directly
+
+
+#include "../src/astar.h"
+
+static uint64_t next_random(uint64_t* state)
+{
+    // xorshift64, fixed seed so every run searches from the same sources
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static int compare_ids(const void* a, const void* b)
+{
+    uint64_t id_a = *(const uint64_t*) a;
+    uint64_t id_b = *(const uint64_t*) b;
+    return (id_a>id_b)-(id_a<id_b);
+}
+
+int main(int argc, char* argv[])
+{
+    Graph graph;
+    int code;
+    SearchWorkspace workspace;
+    unsigned long nr_of_searches = 200;
+    double max_distance = 20000;
+    uint64_t* sorted_ids;
+    uint64_t state = 88172645463325252ULL;
+    unsigned long nr_of_settled_nodes = 0;
+    struct timespec start, end;
+    double milliseconds;
+
+    if (argc<2) {
+        printf("Usage: ./bench_locality file.bin [nr_of_searches] [max_distance_in_metres]\n");
+        exit(1);
+    }
+    if (argc>2) nr_of_searches = strtoul(argv[2], NULL, 10);
+    if (argc>3) max_distance = strtod(argv[3], NULL);
+    if ((code = read_binary_file(argv[1], &graph))!=0) exit(code);
+    if (graph.nr_of_nodes==0) exit(1);
+
+    // the i-th smallest id is the same node in every node order
+    if ((sorted_ids = malloc(graph.nr_of_nodes*sizeof(uint64_t)))==NULL) exit(1);
+    memcpy(sorted_ids, graph.ids, graph.nr_of_nodes*sizeof(uint64_t));
+    qsort(sorted_ids, graph.nr_of_nodes, sizeof(uint64_t), compare_ids);
+
+    init_workspace(&workspace, graph.nr_of_nodes, DARY_HEAP);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (unsigned long i = 0; i<nr_of_searches; ++i) {
+        unsigned long source = get_node_by_id(&graph, sorted_ids[next_random(&state)%graph.nr_of_nodes]);
+        nr_of_settled_nodes += dijkstra(source, &graph, &workspace, false, max_distance, NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    milliseconds = elapsed_milliseconds(start, end);
+
+    printf("%lu nodes, %lu searches up to %.0f m\n", graph.nr_of_nodes, nr_of_searches, max_distance);
+    printf("%lu settled nodes in %.1f ms: %.2f million settled nodes/s\n", nr_of_settled_nodes, milliseconds,
+            nr_of_settled_nodes/milliseconds/1000.0);
+
+    free(sorted_ids);
+    free_workspace(&workspace);
+    free_graph(&graph);
+    return 0;
+}
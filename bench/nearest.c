@@ -0,0 +1,109 @@
+// nearest.c
+// benchmark of the lookup of the closest routable node: the spatial index of the .bin against a scan of all nodes
+//
+// usage: ./bench_nearest /path/to/my/file.bin [nr_of_lookups]
+//
+// looks up the same pseudo random coordinates in the bounding box of the graph with both methods and prints the
+// time per lookup, exits with 1 if the two methods disagree
+
+
+#include "../src/astar.h"
+
+static uint64_t next_random(uint64_t* state)
+{
+    // xorshift64, fixed seed so every run looks up the same coordinates
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static unsigned long scan_nodes(Graph* graph, double lat, double lon, double* distance)
+{
+    // the closest routable node by looking at every node, with the distances of nearest_node
+    double metres_per_degree = R*M_PI/180;
+    double metres_per_degree_lon = metres_per_degree*cos(lat*M_PI/180);
+    double best_squared_distance = DBL_MAX, squared_distance, dy, dx;
+    unsigned long best_index = ULONG_MAX;
+
+    for (unsigned long i = 0; i<graph->nr_of_nodes; ++i) {
+        if (graph->offsets[i+1]==graph->offsets[i] && graph->reverse_offsets[i+1]==graph->reverse_offsets[i]) continue;
+        dy = (node_lat(graph, i)-lat)*metres_per_degree;
+        dx = (node_lon(graph, i)-lon)*metres_per_degree_lon;
+        squared_distance = dy*dy+dx*dx;
+        if (squared_distance<best_squared_distance) {
+            best_squared_distance = squared_distance;
+            best_index = i;
+        }
+    }
+    *distance = sqrt(best_squared_distance);
+    return best_index;
+}
+
+int main(int argc, char* argv[])
+{
+    Graph graph;
+    int code;
+    unsigned long nr_of_lookups = 1000000;
+    unsigned long nr_of_scans;
+    double* lats;
+    double* lons;
+    double* distances;
+    double distance;
+    SpatialIndex* grid;
+    uint64_t state = 88172645463325252ULL;
+    struct timespec start, end;
+    double index_milliseconds, scan_milliseconds;
+
+    if (argc<2) {
+        printf("Usage: ./bench_nearest file.bin [nr_of_lookups]\n");
+        exit(1);
+    }
+    if (argc>2) nr_of_lookups = strtoul(argv[2], NULL, 10);
+    if ((code = read_binary_file(argv[1], &graph))!=0) exit(code);
+    grid = graph.spatial_index;
+    if (grid->nr_of_indexed_nodes==0 || nr_of_lookups==0) exit(1);
+
+    lats = malloc(nr_of_lookups*sizeof(double));
+    lons = malloc(nr_of_lookups*sizeof(double));
+    distances = malloc(nr_of_lookups*sizeof(double));
+    if (lats==NULL || lons==NULL || distances==NULL) exit(1);
+    for (unsigned long i = 0; i<nr_of_lookups; ++i) {
+        lats[i] = grid->min_lat+grid->rows*grid->cell_lat*(next_random(&state)%1000000)/1e6;
+        lons[i] = grid->min_lon+grid->columns*grid->cell_lon*(next_random(&state)%1000000)/1e6;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (unsigned long i = 0; i<nr_of_lookups; ++i) {
+        nearest_node(&graph, lats[i], lons[i], &distances[i]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    index_milliseconds = elapsed_milliseconds(start, end);
+
+    // the scan is slow, a part of the lookups is enough to compare
+    nr_of_scans = nr_of_lookups<1000 ? nr_of_lookups : 1000;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (unsigned long i = 0; i<nr_of_scans; ++i) {
+        scan_nodes(&graph, lats[i], lons[i], &distance);
+        // two nodes at the same distance may be found in another order
+        if (distance!=distances[i]) {
+            printf("Mismatch for %.7f,%.7f: %.3f m, the scan found %.3f m\n", lats[i], lons[i], distances[i],
+                    distance);
+            exit(1);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    scan_milliseconds = elapsed_milliseconds(start, end);
+
+    printf("%lu nodes, %u indexed in %u x %u cells, %lu lookups\n", graph.nr_of_nodes, grid->nr_of_indexed_nodes,
+            grid->columns, grid->rows, nr_of_lookups);
+    printf("scan:          %.3f us/lookup\n", 1e3*scan_milliseconds/nr_of_scans);
+    printf("spatial index: %.3f us/lookup (%.0fx)\n", 1e3*index_milliseconds/nr_of_lookups,
+            (scan_milliseconds/nr_of_scans)/(index_milliseconds/nr_of_lookups));
+
+    free(lats);
+    free(lons);
+    free(distances);
+    free_graph(&graph);
+    return 0;
+}
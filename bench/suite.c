@@ -0,0 +1,193 @@
+// suite.c
+// benchmark suite of the router on a .csv: import, load, preprocessing and fixed query sets per configuration
+//
+// usage: ./bench_suite /path/to/my/file.csv [nr_of_queries] [repetitions]
+//
+// writes file.bin, file.alt and file.ch next to the .csv, the .csv is usually one of bench_generate
+// every step is repeated and reported with the median and percentiles of its times, a query set is answered
+// repetitions times and every query counts with the median of its times
+// the queries are pairs of nodes chosen by id with a fixed seed, so the same .csv always gives the same queries;
+// the sum of their lengths and the number of routes found show at a glance whether a change altered the answers
+
+
+#include "../src/astar.h"
+
+#define SUITE_LANDMARKS 16
+
+static uint64_t next_random(uint64_t* state)
+{
+    // xorshift64, fixed seed so every run answers the same queries
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static int compare_ids(const void* a, const void* b)
+{
+    uint64_t id_a = *(const uint64_t*) a;
+    uint64_t id_b = *(const uint64_t*) b;
+    return (id_a>id_b)-(id_a<id_b);
+}
+
+static int compare_doubles(const void* a, const void* b)
+{
+    double x = *(const double*) a;
+    double y = *(const double*) b;
+    return (x>y)-(x<y);
+}
+
+static double percentile(double* sorted_values, unsigned long n, double p)
+{
+    // nearest-rank percentile of ascending sorted values, p in (0, 100]
+    unsigned long rank = (unsigned long) ceil(p/100.0*n);
+    if (rank==0) rank = 1;
+    return sorted_values[rank-1];
+}
+
+static void report(const char* name, double* milliseconds, unsigned long n, const char* details)
+{
+    // one line per step: the median and percentiles of its times in ms, sorts milliseconds
+    qsort(milliseconds, n, sizeof(double), compare_doubles);
+    printf("%-34s p50 %10.3f | p90 %10.3f | p99 %10.3f | max %10.3f ms%s\n", name, percentile(milliseconds, n, 50),
+            percentile(milliseconds, n, 90), percentile(milliseconds, n, 99), milliseconds[n-1], details);
+}
+
+static void check(AStarCode code, const char* step)
+{
+    if (code==ASTAR_OK) return;
+    fprintf(stderr, "%s: %s\n", step, astar_code_message(code));
+    exit(code);
+}
+
+static void run_queries(const char* name, AStarGraph* graph, const AStarOptions* options, uint64_t* pairs,
+        unsigned long nr_of_queries, unsigned long repetitions)
+{
+    // answers the query set repetitions times with one query handle and reports the median time of every query
+    AStarQuery* query;
+    AStarPath path;
+    AStarStats stats;
+    double* times = malloc(repetitions*sizeof(double));
+    double* latencies = malloc(nr_of_queries*sizeof(double));
+    double length_sum = 0;
+    unsigned long nr_of_routes = 0, settled_nodes = 0;
+    char details[128];
+
+    if (times==NULL || latencies==NULL) exit(1);
+    check(astar_query_create(graph, options, &query), name);
+    for (unsigned long i = 0; i<nr_of_queries; ++i) {
+        for (unsigned long r = 0; r<repetitions; ++r) {
+            if (astar_route(query, pairs[2*i], pairs[2*i+1], &path)==ASTAR_OK && r==0) {
+                length_sum += path.length;
+                nr_of_routes++;
+            }
+            astar_query_stats(query, &stats);
+            times[r] = stats.milliseconds;
+        }
+        settled_nodes += stats.settled_nodes;
+        qsort(times, repetitions, sizeof(double), compare_doubles);
+        latencies[i] = percentile(times, repetitions, 50);
+    }
+    snprintf(details, sizeof(details), " | %lu routes, %.0f m | %.0f settled", nr_of_routes, length_sum,
+            (double) settled_nodes/nr_of_queries);
+    report(name, latencies, nr_of_queries, details);
+
+    astar_query_free(query);
+    free(latencies);
+    free(times);
+}
+
+int main(int argc, char* argv[])
+{
+    char* csv_filename;
+    char* filename;
+    unsigned long nr_of_queries = 1000;
+    unsigned long repetitions = 5;
+    double* milliseconds;
+    struct timespec start, end;
+    uint64_t state = 88172645463325252ULL;
+    uint64_t* sorted_ids;
+    uint64_t* pairs;
+    Graph graph;
+    AStarGraph* handle;
+    AStarOptions side_options = {.algorithm="ch", .heuristic="landmarks", .queue=NULL};
+    char details[64];
+    size_t nr_of_shortcuts;
+    int code;
+
+    if (argc<2) {
+        printf("Usage: ./bench_suite file.csv [nr_of_queries] [repetitions]\n");
+        exit(1);
+    }
+    csv_filename = argv[1];
+    if (argc>2) nr_of_queries = strtoul(argv[2], NULL, 10);
+    if (argc>3) repetitions = strtoul(argv[3], NULL, 10);
+    if (nr_of_queries==0 || repetitions==0 || strrchr(csv_filename, '.')==NULL) exit(1);
+    if ((filename = malloc(strlen(csv_filename)+5))==NULL) exit(1);
+    strcpy(filename, csv_filename);
+    strcpy(strrchr(filename, '.'), ".bin");
+    if ((milliseconds = malloc(repetitions*sizeof(double)))==NULL) exit(1);
+
+    for (unsigned long r = 0; r<repetitions; ++r) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        check(astar_convert(csv_filename, 1, NULL, false), "import");
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        milliseconds[r] = elapsed_milliseconds(start, end);
+    }
+    if ((code = read_binary_file(filename, &graph))!=0) exit(code);
+    snprintf(details, sizeof(details), " | %lu nodes, %lu edges", graph.nr_of_nodes, graph.nr_of_edges);
+    report("import .csv", milliseconds, repetitions, details);
+
+    // the i-th smallest id is the same node in every node order
+    if ((sorted_ids = malloc(graph.nr_of_nodes*sizeof(uint64_t)))==NULL) exit(1);
+    if ((pairs = malloc(2*nr_of_queries*sizeof(uint64_t)))==NULL) exit(1);
+    memcpy(sorted_ids, graph.ids, graph.nr_of_nodes*sizeof(uint64_t));
+    qsort(sorted_ids, graph.nr_of_nodes, sizeof(uint64_t), compare_ids);
+    for (unsigned long i = 0; i<2*nr_of_queries; ++i) pairs[i] = sorted_ids[next_random(&state)%graph.nr_of_nodes];
+    free(sorted_ids);
+    free_graph(&graph);
+
+    for (unsigned long r = 0; r<repetitions; ++r) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        check(astar_open(filename, NULL, &handle), "load .bin");
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        milliseconds[r] = elapsed_milliseconds(start, end);
+        astar_close(handle);
+    }
+    report("load .bin", milliseconds, repetitions, "");
+
+    // the preprocessing takes long on large graphs, it runs once
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    check(astar_build_landmarks(filename, NULL, SUITE_LANDMARKS), "landmarks");
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    milliseconds[0] = elapsed_milliseconds(start, end);
+    report("landmarks (-L 16)", milliseconds, 1, "");
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    check(astar_contract(filename, &nr_of_shortcuts), "contraction");
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    milliseconds[0] = elapsed_milliseconds(start, end);
+    snprintf(details, sizeof(details), " | %lu shortcuts", (unsigned long) nr_of_shortcuts);
+    report("contraction (-C)", milliseconds, 1, details);
+
+    // one graph with both side files serves every configuration
+    check(astar_open(filename, &side_options, &handle), "load .bin, .alt and .ch");
+    run_queries("astar haversine heap", handle, &(AStarOptions) {"astar", "haversine", "heap"}, pairs, nr_of_queries,
+            repetitions);
+    run_queries("astar haversine radix", handle, &(AStarOptions) {"astar", "haversine", "radix"}, pairs,
+            nr_of_queries, repetitions);
+    run_queries("astar equirectangular heap", handle, &(AStarOptions) {"astar", "equirectangular", "heap"}, pairs,
+            nr_of_queries, repetitions);
+    run_queries("astar landmarks heap", handle, &(AStarOptions) {"astar", "landmarks", "heap"}, pairs, nr_of_queries,
+            repetitions);
+    run_queries("bidirectional haversine heap", handle, &(AStarOptions) {"bidirectional", "haversine", "heap"}, pairs,
+            nr_of_queries, repetitions);
+    run_queries("bidirectional landmarks heap", handle, &(AStarOptions) {"bidirectional", "landmarks", "heap"}, pairs,
+            nr_of_queries, repetitions);
+    run_queries("ch", handle, &(AStarOptions) {"ch", NULL, "heap"}, pairs, nr_of_queries, repetitions);
+    astar_close(handle);
+
+    free(pairs);
+    free(milliseconds);
+    free(filename);
+    return 0;
+}
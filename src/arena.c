@@ -0,0 +1,67 @@
+// arena.c
+// arena allocator for the memory a query needs only until the next query
+// the blocks are kept when the arena is reset, so a context answering many queries allocates nothing once
+// its blocks have the working size
+
+
+#include "astar.h"
+
+void arena_init(Arena* arena)
+{
+    // prepares an empty arena, the first block is allocated by the first arena_alloc
+    arena->first = NULL;
+    arena->current = NULL;
+    arena->used = 0;
+}
+
+void* arena_alloc(Arena* arena, size_t size)
+{
+    // returns size bytes aligned for any type, valid until the next arena_reset or arena_free
+    // requests larger than ARENA_BLOCK_SIZE get a block of their own size
+
+    ArenaBlock* block;
+
+    size = (size+ARENA_ALIGNMENT-1)&~(size_t) (ARENA_ALIGNMENT-1);
+    while (arena->current==NULL || arena->used+size>arena->current->size) {
+        // go on with the next block kept from before the last reset if it is large enough
+        block = arena->current==NULL ? arena->first : arena->current->next;
+        if (block==NULL || block->size<size) {
+            if ((block = malloc(sizeof(ArenaBlock)+(size>ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE)))==NULL) exit(1);
+            block->size = size>ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+            // the new block goes in right after the current one, the blocks behind it are still used later
+            if (arena->current==NULL) {
+                block->next = arena->first;
+                arena->first = block;
+            }
+            else {
+                block->next = arena->current->next;
+                arena->current->next = block;
+            }
+        }
+        arena->current = block;
+        arena->used = 0;
+    }
+    arena->used += size;
+    // the data of a block follows its header, which is a multiple of the alignment
+    return (char*) (arena->current+1)+arena->used-size;
+}
+
+void arena_reset(Arena* arena)
+{
+    // releases everything allocated from the arena at once but keeps the blocks for the next allocations
+    arena->current = NULL;
+    arena->used = 0;
+}
+
+void arena_free(Arena* arena)
+{
+    // returns all blocks to the system
+    ArenaBlock* next;
+
+    while (arena->first!=NULL) {
+        next = arena->first->next;
+        free(arena->first);
+        arena->first = next;
+    }
+    arena_init(arena);
+}
@@ -4,121 +4,55 @@
 
 #include "astar.h"
 
-void add_element_to_list(unsigned long index_to_add, list_elem** start_of_list, AStarStatus* astar_status_list)
+unsigned long get_node_by_id(Graph* graph, unsigned long id)
 {
-    // adds an element to a list
-    // the list is always sorted in ascending order
-    // the sorting key is the fscore computed from the AStarStatus
+    // returns the index of a node in the node arrays for a given id
+    // uses the id index if the graph has one and binary search on the sorted ids otherwise
+    // (a graph whose nodes were reordered always has an id index)
+    // returns ULONG_MAX (biggest possible unsigned long) if node is not found
     //
-    // returned is the beginning of the list (by a pointer)
-    // i.e. either the new element if it is the lowest or
-    // the start from before
-
-    list_elem* next_elem = NULL;
-    list_elem* current_elem = NULL;
-    list_elem* new_elem = NULL;
-
-    double fscore_of_index_to_add = get_fscore(astar_status_list[index_to_add]);
-
-    // we have to allocate memory to make it count across the borders of this method
-    new_elem = malloc(sizeof(list_elem));
-
-    next_elem = *start_of_list;
-
-
-    // check if element is actually the lowest
-    if ((next_elem==NULL) ||
-            (fscore_of_index_to_add<=get_fscore(astar_status_list[next_elem->index]))) {
-        // add element to the beginning of the list
-        // and return new element as the start of the list
-        new_elem->index = index_to_add;
-        new_elem->next = next_elem;
-        *start_of_list = new_elem;
-        return;
-    }
+    // why does ULONG_MAX work as a "not found" return value?
+    // the number of nodes n is an unsigned long, let's assume n=ULONG_MAX
+    // then we have the indices 0..ULONG_MAX-1
+    // -> ULONG_MAX can never be an index and means therefore it is not found
+    // Note (by such a number of nodes our RAM probably would have killed us anyway :D)
 
-    // go through the list
-    while (next_elem->next!=NULL) {
-        current_elem = next_elem;
-        next_elem = next_elem->next;
-        if (fscore_of_index_to_add<=get_fscore(astar_status_list[next_elem->index])) {
-            // insert the element to the list between current_elem and next_elem
-            // and return the start of the list (it did'nt change)
-            new_elem->index = index_to_add;
-            new_elem->next = next_elem;
-            current_elem->next = new_elem;
-            return;
-        }
-    }
-    // we land here if we reached the end
-    // i.e. the element has the worst fscore
-    new_elem->index = index_to_add;
-    new_elem->next = NULL;
-    next_elem->next = new_elem;
+    if (graph->id_index!=NULL) return search_id_index(graph, id);
+    return search_sorted_ids(graph, id);
 }
 
-void remove_element_from_list(unsigned long index_to_remove, list_elem** start_of_list)
+unsigned long search_id_index(Graph* graph, unsigned long id)
 {
-    // removes an element from a list
-    //
-    // returns a pointer to the start of the list
+    // looks the id up in the hash table, probing the following slots until an empty one
+    // one probe is usually enough as at most half of the slots are in use
 
-    list_elem* current_elem = *start_of_list;
-    list_elem* next_elem = NULL;
+    unsigned long mask = graph->id_index_size-1;
+    unsigned long slot = id_hash(id) & mask;
 
-    // check if first element is the wanted one
-    if (current_elem->index==index_to_remove) {
-        *start_of_list = current_elem->next;
-        free(current_elem);
-        return;
+    while (graph->id_index[slot]!=UINT32_MAX) {
+        if (graph->ids[graph->id_index[slot]]==id) return graph->id_index[slot];
+        slot = (slot+1) & mask;
     }
-
-    // go through the list
-    next_elem = current_elem->next;
-    while (next_elem!=NULL) {
-        if (next_elem->index==index_to_remove) {
-            current_elem->next = next_elem->next;
-            free(next_elem);
-            return;
-        }
-        current_elem = next_elem;
-        next_elem = current_elem->next;
-    }
-
-    // if we are here we could not find the element in the list
-    // not sure how to handle this so far
-    // for now we throw an error and exit
-    exit(41);
-}
-
-double get_fscore(AStarStatus astarstatus)
-{
-    // returns the fscore from a node, in particular from an AStarStatus
-    // convenience function
-    return astarstatus.g+astarstatus.h;
+    return ULONG_MAX;
 }
 
-unsigned long get_node_by_id(node* nodes, unsigned long n, unsigned long id)
+unsigned long search_sorted_ids(Graph* graph, unsigned long id)
 {
-    // returns the index of a node in the array for a given id
-    // uses binary search
-    // returns ULONG_MAX (biggest possible unsigned long) if node is not found
-    //
-    // why does ULONG_MAX work as a "not found" return value?
-    // the number of nodes n is an unsigned long, let's assume n=ULONG_MAX
-    // then we have the indices 0..ULONG_MAX-1
-    // -> ULONG_MAX can never be an index and means therefore it is not found
-    // Note (by such a number of nodes our RAM probably would have killed us anyway :D)
+    // binary search on the sorted ids
 
     unsigned long first = 0;
-    unsigned long last = n-1;
+    unsigned long last = graph->nr_of_nodes-1;
+
+    if (graph->nr_of_nodes==0) return ULONG_MAX;
     unsigned long middle = (first+last)/2;
 
     while (first<=last) {
-        if (nodes[middle].id<id)
+        if (graph->ids[middle]<id)
             first = middle+1;
-        else if (nodes[middle].id==id)
+        else if (graph->ids[middle]==id)
             return middle;
+        else if (middle==0)
+            break; // id is smaller than all ids, last would wrap around
         else
             last = middle-1;
         middle = (first+last)/2;
@@ -126,18 +60,20 @@ unsigned long get_node_by_id(node* nodes, unsigned long n, unsigned long id)
     return ULONG_MAX;
 }
 
-double equirectangular_distance(unsigned long node_a_index, unsigned long node_b_index, node* nodes)
+double equirectangular_distance(unsigned long node_a_index, unsigned long node_b_index, Graph* graph)
 {
     // returns the Equirectangular approximation distance between two neighbouring nodes
     // this approximation is less accurate than the heuristic 'haversine' distance but we use this only for really close nodes
     // advantage: it is faster than the heuristic distance
-    // given are two indices (not IDs) of nodes in the nodes list, the nodes list itself and the length of the list.
+    // it can be a little longer than the haversine edge lengths, so as a heuristic it is not admissible: the routes
+    // are approximate and the fscores not monotone, which is why it is not allowed with the radix heap
+    // given are two indices (not IDs) of nodes in the graph and the graph itself.
     // if the nodes are not adjacent the return value is -1
 
-    double lat_a = nodes[node_a_index].lat*M_PI/180.0;;
-    double lon_a = nodes[node_a_index].lon*M_PI/180.0;;
-    double lat_b = nodes[node_b_index].lat*M_PI/180.0;;
-    double lon_b = nodes[node_b_index].lon*M_PI/180.0;;
+    double lat_a = node_lat(graph, node_a_index)*M_PI/180.0;
+    double lon_a = node_lon(graph, node_a_index)*M_PI/180.0;
+    double lat_b = node_lat(graph, node_b_index)*M_PI/180.0;
+    double lon_b = node_lon(graph, node_b_index)*M_PI/180.0;
     double diff_lat = lat_a-lat_b;
     double diff_lon = lon_a-lon_b;
 
@@ -149,15 +85,15 @@ double equirectangular_distance(unsigned long node_a_index, unsigned long node_b
     return weight;
 }
 
-double haversine_distance(unsigned long node_a_index, unsigned long node_b_index, node* nodes)
+double haversine_distance(unsigned long node_a_index, unsigned long node_b_index, Graph* graph)
 {
     // returns the haversine distance
-    // given are two indices (not IDs) of nodes in the nodes list, the nodes list itself
+    // given are two indices (not IDs) of nodes in the graph and the graph itself
 
-    double lat_a = nodes[node_a_index].lat*M_PI/180.0;
-    double lon_a = nodes[node_a_index].lon*M_PI/180.0;
-    double lat_b = nodes[node_b_index].lat*M_PI/180.0;
-    double lon_b = nodes[node_b_index].lon*M_PI/180.0;
+    double lat_a = node_lat(graph, node_a_index)*M_PI/180.0;
+    double lon_a = node_lon(graph, node_a_index)*M_PI/180.0;
+    double lat_b = node_lat(graph, node_b_index)*M_PI/180.0;
+    double lon_b = node_lon(graph, node_b_index)*M_PI/180.0;
     double diff_lat = lat_a-lat_b;
     double diff_lon = lon_a-lon_b;
 
@@ -169,179 +105,319 @@ double haversine_distance(unsigned long node_a_index, unsigned long node_b_index
 }
 
 double
-heuristic_distance(unsigned long node_a_index, unsigned long node_b_index, node* nodes, Heuristic distance_method)
+heuristic_distance(unsigned long node_a_index, unsigned long node_b_index, Graph* graph, Heuristic distance_method)
 {
     // returns the heuristic distance
     // i.e. the direct shortest distance on the air surface
-    // given are two indices (not IDs) of nodes in the nodes list, the nodes list itself and the method to use for the
+    // given are two indices (not IDs) of nodes in the graph, the graph itself and the method to use for the
     // computation
-    // possible options: HAVERSINE or EQUIRECTANGULAR
+    // possible options: HAVERSINE, EQUIRECTANGULAR or LANDMARKS
     // for more information look here http://www.movable-type.co.uk/scripts/latlong.html
+    // LANDMARKS is not a distance on the surface but the ALT lower bound on the road distance from a to b,
+    // it needs the landmark tables in graph->landmarks
+    // HAVERSINE is computed from the unit vectors of the nodes, the same value as haversine_distance without
+    // the trigonometric calls, see distance.c
     if (distance_method==HAVERSINE) {
-        return haversine_distance(node_a_index, node_b_index, nodes);
+        return chord_distance(node_a_index, node_b_index, graph);
     }
     else if (distance_method==EQUIRECTANGULAR) {
-        return equirectangular_distance(node_a_index, node_b_index, nodes);
+        return equirectangular_distance(node_a_index, node_b_index, graph);
+    }
+    else if (distance_method==LANDMARKS && graph->landmarks!=NULL) {
+        return landmark_distance(node_a_index, node_b_index, graph);
     }
-    exit(51); // throw error if no correct distance_method is set
+    // no usable distance_method, which astar_query_create rules out: 0 is a lower bound too, the search becomes
+    // a Dijkstra instead of ending the process
+    return 0;
 }
 
-void write_solution_to_file(char* filename, unsigned long node_goal_index, node* nodes, AStarStatus* status_list)
+void init_workspace(SearchWorkspace* workspace, unsigned long nr_of_nodes, QueueType queue_type)
 {
-    // if an optimal solution is found this function is called
-    // and will write the path from destination to source (so in reverse order!) into a file like spain.out
-
-    FILE* fout;
-    strcpy(strrchr(filename, '.'), ".out");
-
-    if ((fout = fopen(filename, "w"))==NULL) exit(31);
+    // allocates everything a search over a graph with nr_of_nodes nodes needs
+    // the workspace can be used for any number of searches, each one starts with reset_workspace
+
+    workspace->nr_of_nodes = nr_of_nodes;
+    workspace->status_list = malloc(nr_of_nodes*sizeof(AStarStatus));
+    // calloc because every node has to start with an old generation, i.e. as NONE
+    workspace->generation = calloc(nr_of_nodes, sizeof(unsigned int));
+    workspace->current_generation = 0;
+    if (workspace->status_list==NULL || workspace->generation==NULL) exit(1);
+    queue_init(&workspace->open_queue, queue_type, nr_of_nodes);
+}
 
-    fprintf(fout, "Optimal Path found: \n");
+void free_workspace(SearchWorkspace* workspace)
+{
+    free(workspace->status_list);
+    free(workspace->generation);
+    queue_free(&workspace->open_queue);
+    workspace->status_list = NULL;
+    workspace->generation = NULL;
+}
 
-    unsigned long current_index = node_goal_index;
-    while (current_index!=ULONG_MAX) {
-        fprintf(fout, "Node id:\t %lu\t| Distance:\t%.2f\n", nodes[current_index].id, status_list[current_index].g);
-        current_index = status_list[current_index].parent;
+void reset_workspace(SearchWorkspace* workspace)
+{
+    // prepares the workspace for a new search
+    // instead of clearing the status list the generation is increased, which turns every node into NONE
+    // only on the (very rare) overflow of the counter the generations have to be cleared
+    // the counters start again as well, the ones of the queue here and not in queue_clear because the
+    // hierarchy search clears a queue in the middle of the search
+
+    workspace->current_generation++;
+    if (workspace->current_generation==0) {
+        memset(workspace->generation, 0, workspace->nr_of_nodes*sizeof(unsigned int));
+        workspace->current_generation = 1;
     }
-    fclose(fout);
-    printf("Optimal Path is written to %s", filename);
+    queue_clear(&workspace->open_queue);
+    memset(&workspace->stats, 0, sizeof(SearchStats));
+    workspace->open_queue.pushes = 0;
+    workspace->open_queue.decrease_keys = 0;
+    workspace->open_queue.pops = 0;
+    workspace->open_queue.max_size = 0;
+}
 
+static void push_pending(SearchWorkspace* workspace, uint32_t* pending, unsigned long nr_of_pending,
+        unsigned long goal_index, Graph* graph, Heuristic distance_method)
+{
+    // computes the hscores of the nodes which were just opened with one call of the distance kernel
+    // and puts them into the open list with fscore = gscore+hscore
+    double h[DISTANCE_BATCH];
+
+    if (nr_of_pending==0) return;
+    heuristic_batch(pending, nr_of_pending, goal_index, graph, distance_method, h);
+    workspace->stats.heuristic_evaluations += nr_of_pending;
+    for (unsigned long i = 0; i<nr_of_pending; ++i) {
+        queue_push(&workspace->open_queue, pending[i], workspace->status_list[pending[i]].g+h[i]);
+    }
 }
 
-void astar(unsigned long node_start, unsigned long node_goal, node* nodes, unsigned long nr_of_nodes,
-        Heuristic distance_method, char* filename)
+bool astar_search(unsigned long start_index, unsigned long goal_index, Graph* graph, SearchWorkspace* workspace,
+        Heuristic distance_method)
 {
-    // node_start is the source node id
-    // node_goal is the goal node id
-    // the indices in the nodes list have to be obtained by get_node_by_id
-    // nr_of_nodes states the length of the nodes list
-    // the distance_method is either HAVERSINE (more accurate) or EQUIRECTANGULAR (faster) for the distance computation
-    // filename is used to pass the parameter to write_solution_to_file function for the output solution file
-
-    unsigned long start_index = get_node_by_id(nodes, nr_of_nodes, node_start);
-    unsigned long goal_index = get_node_by_id(nodes, nr_of_nodes, node_goal);
-
-    AStarStatus* status_list = malloc(nr_of_nodes*sizeof(AStarStatus));
-    list_elem* OPEN_LIST = NULL;
-    // we do not have to store a linked list for the closed nodes
+    // runs A* from start_index to goal_index, both indices in the graph (not ids)
+    // the distance_method is either HAVERSINE (more accurate) or EQUIRECTANGULAR (faster) for the heuristic
+    // the edge lengths are taken from the graph, they were computed when the graph was built
+    // returns true if a path is found, the path can be followed by the parents in the status list
+    // of the workspace starting at goal_index
+
+    PriorityQueue* open_queue = &workspace->open_queue;
+    AStarStatus* status_list = workspace->status_list;
+    // we do not have to store a queue for the closed nodes
     // we can get this information from the AStarStatus/status_list
-    list_elem* current_element = NULL;
+    AStarStatus* current;
+    AStarStatus* successor;
     unsigned long current_index;
 
     unsigned long node_successor_index;
-    double successor_current_cost;
+    float successor_current_cost; // a float like g, so it is rounded before it is compared with g
+    // reached nodes whose hscore is still missing, it is computed for all of them at once
+    uint32_t pending[DISTANCE_BATCH];
+    unsigned long nr_of_pending;
+
+    reset_workspace(workspace);
 
     // put node_start (i.e. start_index) in open list with fscore = hscore
-    status_list[start_index].g = 0;
-    status_list[start_index].h = heuristic_distance(start_index, goal_index, nodes, distance_method);
-    status_list[start_index].parent = ULONG_MAX; //the parent is set to ULONG_MAX because the start node has no parent
-    status_list[start_index].whq = OPEN;
-    add_element_to_list(start_index, &OPEN_LIST, status_list);
+    // the hscore is not stored in the status, the queue keeps the fscore
+    current = get_status(workspace, start_index);
+    current->g = 0;
+    current->parent = NO_PARENT; //the start node has no parent
+    current->whq = OPEN;
+    queue_push(open_queue, start_index, heuristic_distance(start_index, goal_index, graph, distance_method));
+    workspace->stats.heuristic_evaluations++;
 
     // while open list is not empty
-    while (OPEN_LIST!=NULL) {
-        // get minimal node
-        current_element = OPEN_LIST;
-        current_index = current_element->index;
-
-        if (current_index==goal_index) {
-            printf("Solution found. With length of %f.\n", status_list[current_index].g);
-            write_solution_to_file(filename, goal_index, nodes, status_list);
-            return;
-        }
+    while (!queue_is_empty(open_queue)) {
+        // get minimal node and close it
+        current_index = queue_pop(open_queue);
+        if (current_index==goal_index) return true;
+
+        current = &status_list[current_index];
+        current->whq = CLOSED;
+        workspace->stats.settled_nodes++;
+        workspace->stats.relaxed_edges += graph->offsets[current_index+1]-graph->offsets[current_index];
 
         // generate for each neighbour of current_element the AStar state
-        for (int i = 0; i<nodes[current_index].nsucc; ++i) {
-            node_successor_index = nodes[current_index].successors[i];
-            successor_current_cost =
-                    status_list[current_index].g+
-                            heuristic_distance(current_index, node_successor_index, nodes, distance_method);
-            if (status_list[node_successor_index].whq==OPEN) {
-                if (status_list[node_successor_index].g<=successor_current_cost) continue;
-                else {
-                    status_list[node_successor_index].g = successor_current_cost;
-                    status_list[node_successor_index].parent = current_index;
-                    // we have to remove and add the element again because the distances were updated
-                    // and we want to keep a sorted list
-                    remove_element_from_list(node_successor_index, &OPEN_LIST);
-                    add_element_to_list(node_successor_index, &OPEN_LIST, status_list);
-                }
-            }
-            else if (status_list[node_successor_index].whq==CLOSED) {
-                if (status_list[node_successor_index].g<=successor_current_cost) continue;
-                status_list[node_successor_index].g = successor_current_cost;
-                status_list[node_successor_index].parent = current_index;
-                add_element_to_list(node_successor_index, &OPEN_LIST, status_list);
-                status_list[node_successor_index].whq = OPEN;
+        // the successors are a contiguous range of the targets array
+        nr_of_pending = 0;
+        for (uint32_t i = graph->offsets[current_index]; i<graph->offsets[current_index+1]; ++i) {
+            node_successor_index = graph->targets[i];
+            successor = get_status(workspace, node_successor_index);
+            successor_current_cost = current->g+graph->weights[i];
+            if (successor->whq==OPEN) {
+                if (successor->g<=successor_current_cost) continue;
+                // the hscore did not change, the fscore drops by the same amount as the gscore
+                queue_decrease_key(open_queue, node_successor_index,
+                        queue_key(open_queue, node_successor_index)-(successor->g-successor_current_cost));
+                successor->g = successor_current_cost;
+                successor->parent = current_index;
             }
             else {
-                status_list[node_successor_index].g = successor_current_cost;
-                status_list[node_successor_index].parent = current_index;
-                status_list[node_successor_index].whq = OPEN;
-                status_list[node_successor_index].h = heuristic_distance(node_successor_index, goal_index, nodes,
-                        distance_method);
-                add_element_to_list(node_successor_index, &OPEN_LIST, status_list);
+                // reopen a CLOSED node only if the gscore improves, a NONE node is new
+                if (successor->whq==CLOSED) {
+                    if (successor->g<=successor_current_cost) continue;
+                    workspace->stats.reopened_nodes++;
+                }
+                successor->g = successor_current_cost;
+                successor->parent = current_index;
+                successor->whq = OPEN;
+                pending[nr_of_pending++] = (uint32_t) node_successor_index;
+                if (nr_of_pending==DISTANCE_BATCH) {
+                    push_pending(workspace, pending, nr_of_pending, goal_index, graph, distance_method);
+                    nr_of_pending = 0;
+                }
             }
         }
-        // set current_element to closed and remove it from open list
-        remove_element_from_list(current_index, &OPEN_LIST);
-        status_list[current_index].whq = CLOSED;
+        push_pending(workspace, pending, nr_of_pending, goal_index, graph, distance_method);
     }
 
     // if we reach this we did not find a solution
-    printf("No solution found. The OPEN_LIST is empty.\n");
-    exit(11);
+    return false;
 }
 
-int main(int argc, char* argv[])
+void init_path(Path* path)
 {
-    // depending on how the input file (only parameter) is named it will read a file and run the astar algorithm
-    //
-    // if file is named *.csv it will read the csv file and construct the graph (i.e. node list)
-    // and then write this information to a binary file for faster reading at a later stage
-    //
-    // if the file is named *.bin it will read the binary, construct the graph and run the A* algorithm
-    //
-    // usage:   ./astar /path/to/my/file.csv  OR
-    //          ./astar /path/to/my/file.bin
-
-    char filename[100];
-    bool binary = false; // switch for reading a .csv or a .bin file, depends on the line ending
-
-    Heuristic distance_method = HAVERSINE; //possible options HAVERSINE or EQUIRECTANGULAR, change here if wanted
-    unsigned long nr_of_nodes;
-    node* nodes;
-    unsigned long node_start = 240949599; //default start node id for the spain.csv
-    unsigned long node_goal = 195977239; //default end node id for the spain.csv
-
-    //parse command line arguments
-    if (argc<=1) {
-        printf("Please specify at least a .csv for parsing or a .bin for computing a route.\nUsage: ./astar spain.csv");
-        exit(1);
-    }
-    else if (argc>=2) {
-        //set filename
-        strcpy(filename, argv[1]);
-        if (argc==4) {
-            //set source and destination ids, ignored if a .csv file is read
-            node_start = strtoul(argv[2], NULL, 10);
-            node_goal = strtoul(argv[3], NULL, 10);
-        }
+    path->nr_of_nodes = 0;
+    path->capacity = 0;
+    path->indices = NULL;
+    path->distances = NULL;
+    path->length = -1;
+}
+
+void free_path(Path* path)
+{
+    free(path->indices);
+    free(path->distances);
+    init_path(path);
+}
+
+void append_to_path(Path* path, unsigned long index, double distance)
+{
+    // adds a node at the end of the path, the arrays grow by doubling and are kept for the next path
+    if (path->nr_of_nodes==path->capacity) {
+        path->capacity = path->capacity ? 2*path->capacity : 256;
+        path->indices = realloc(path->indices, path->capacity*sizeof(unsigned long));
+        path->distances = realloc(path->distances, path->capacity*sizeof(double));
+        if (path->indices==NULL || path->distances==NULL) exit(1);
     }
+    path->indices[path->nr_of_nodes] = index;
+    path->distances[path->nr_of_nodes] = distance;
+    path->nr_of_nodes++;
+}
+
+void get_path(unsigned long goal_index, AStarStatus* status_list, Path* path)
+{
+    // collects the path found by astar_search by following the parents from the goal
+    // and turns it around, so it goes from start to goal
 
+    unsigned long swap_index;
+    double swap_distance;
 
-    //check if binary file or not (otherwise a csv file is assumed)
-    if (strcmp(strrchr(filename, '.'), ".bin")==0) {
-        binary = true;
+    path->nr_of_nodes = 0;
+    for (unsigned long current_index = goal_index; current_index!=NO_PARENT;
+            current_index = status_list[current_index].parent) {
+        append_to_path(path, current_index, status_list[current_index].g);
     }
+    for (unsigned long i = 0, j = path->nr_of_nodes-1; i<j; ++i, --j) {
+        swap_index = path->indices[i];
+        path->indices[i] = path->indices[j];
+        path->indices[j] = swap_index;
+        swap_distance = path->distances[i];
+        path->distances[i] = path->distances[j];
+        path->distances[j] = swap_distance;
+    }
+    path->length = status_list[goal_index].g;
+}
 
-    //read either a .csv file and create a binary file
-    // or read a binary file and compute a route
-    if (binary==false) {
-        nr_of_nodes = read_csv_file(filename, &nodes);
+void collect_stats(QueryContext* context, SearchStats* stats)
+{
+    // sums the counters of the workspaces of the last query together with the operations of their queues
+    // max_open_size adds the largest sizes of both directions, they may have been reached at different times
+
+    SearchWorkspace* workspaces[2] = {&context->forward, &context->backward};
+    SearchWorkspace* workspace;
+
+    memset(stats, 0, sizeof(SearchStats));
+    for (int i = 0; i<2; ++i) {
+        workspace = workspaces[i];
+        if (workspace->status_list==NULL) continue;
+        stats->settled_nodes += workspace->stats.settled_nodes;
+        stats->relaxed_edges += workspace->stats.relaxed_edges;
+        stats->reopened_nodes += workspace->stats.reopened_nodes;
+        stats->heuristic_evaluations += workspace->stats.heuristic_evaluations;
+        stats->pushes += workspace->open_queue.pushes;
+        stats->decrease_keys += workspace->open_queue.decrease_keys;
+        stats->pops += workspace->open_queue.pops;
+        stats->max_open_size += workspace->open_queue.max_size;
+    }
+}
+
+void init_query_context(QueryContext* context, Graph* graph, SearchOptions* options)
+{
+    // allocates the workspaces the chosen algorithm needs
+    init_workspace(&context->forward, graph->nr_of_nodes, options->queue_type);
+    if (options->algorithm==BIDIRECTIONAL || options->algorithm==CONTRACTION_HIERARCHY) {
+        init_workspace(&context->backward, graph->nr_of_nodes, options->queue_type);
     }
     else {
-        nr_of_nodes = read_binary_file(filename, &nodes);
-        astar(node_start, node_goal, nodes, nr_of_nodes, distance_method, filename);
+        memset(&context->backward, 0, sizeof(SearchWorkspace));
     }
-}
\ No newline at end of file
+    init_path(&context->path);
+    arena_init(&context->scratch);
+}
+
+void free_query_context(QueryContext* context)
+{
+    free_workspace(&context->forward);
+    if (context->backward.status_list!=NULL) free_workspace(&context->backward);
+    free_path(&context->path);
+    arena_free(&context->scratch);
+}
+
+int find_route(unsigned long start_index, unsigned long goal_index, Graph* graph, SearchOptions* options,
+        QueryContext* context)
+{
+    // searches a shortest route between two node indices with the algorithm of the options
+    // returns 0 if there is one, the route is then in context->path, otherwise ASTAR_NO_ROUTE or the code of
+    // hierarchy_search
+    // the scratch memory of the last query is given back first
+
+    arena_reset(&context->scratch);
+    context->path.nr_of_nodes = 0;
+    context->path.length = -1;
+    if (options->algorithm==BIDIRECTIONAL) {
+        return bidirectional_search(start_index, goal_index, graph, &context->forward, &context->backward,
+                options->distance_method, &context->path) ? 0 : ASTAR_NO_ROUTE;
+    }
+    if (options->algorithm==CONTRACTION_HIERARCHY) {
+        return hierarchy_search(start_index, goal_index, graph, &context->forward, &context->backward,
+                &context->scratch, &context->path);
+    }
+    if (!astar_search(start_index, goal_index, graph, &context->forward, options->distance_method)) {
+        return ASTAR_NO_ROUTE;
+    }
+    get_path(goal_index, context->forward.status_list, &context->path);
+    return 0;
+}
+
+bool parse_algorithm(const char* name, Algorithm* algorithm)
+{
+    // converts the name of a search algorithm (astar, bidirectional or ch) into an Algorithm
+    // returns false if the name is unknown
+
+    if (strcmp(name, "astar")==0) *algorithm = UNIDIRECTIONAL;
+    else if (strcmp(name, "bidirectional")==0) *algorithm = BIDIRECTIONAL;
+    else if (strcmp(name, "ch")==0) *algorithm = CONTRACTION_HIERARCHY;
+    else return false;
+    return true;
+}
+
+bool parse_heuristic(const char* name, Heuristic* heuristic)
+{
+    // converts the name of a heuristic (haversine, equirectangular or landmarks) into a Heuristic
+    // returns false if the name is unknown
+
+    if (strcmp(name, "haversine")==0) *heuristic = HAVERSINE;
+    else if (strcmp(name, "equirectangular")==0) *heuristic = EQUIRECTANGULAR;
+    else if (strcmp(name, "landmarks")==0) *heuristic = LANDMARKS;
+    else return false;
+    return true;
+}
@@ -2,9 +2,6 @@
 #ifndef ASTAR_ASTAR_H
 #define ASTAR_ASTAR_H
 
-#endif //ASTAR_ASTAR_H
-
-
 #define _GNU_SOURCE  //necessary for getline method
 
 #include <stdio.h>
@@ -13,21 +10,249 @@
 #include <stdbool.h>
 #include <math.h>
 #include <limits.h>
+#include <float.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <pthread.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <poll.h>
+
+#include "libastar.h"
 
 
 /////////////////////////////////////////////////////////////////////////////
 // CONSTANTS
 #define R 6371000 // Earth's radius
+#define GRAPH_MAGIC "ASTARGR" // first bytes of every binary graph file
+#define GRAPH_VERSION 5 // has to be increased whenever the layout of the binary graph file changes
+#define GRAPH_ENDIANNESS 0x01020304 // written in native byte order, reads differently on a machine of other endianness
+#define GRAPH_PAGE_SIZE 4096 // every section of the binary graph file starts at a multiple of this
+#define GRAPH_MAX_SECTIONS 16 // slots in the section table of the binary graph file
+#define NO_PARENT ((1u << 30) - 1) // parent of the start node in AStarStatus, also the limit for the number of nodes
+#define GRAPH_IDS_SORTED 1 // header flag: the nodes are in ascending id order
+#define COORDINATE_SCALE 1e7 // fixed-point coordinates (-F) are in 1e-7 degrees, about 1 cm
+#define DISTANCE_BATCH 64 // nodes per call of a distance kernel, see heuristic_batch
+#define SPATIAL_NODES_PER_CELL 2 // average number of nodes per cell of the spatial index
+#define SPATIAL_SHORT_RING 2 // rings up to this one are scanned whole, their few cells are faster than clipping
+#define HILBERT_BITS 16 // the Hilbert order maps the coordinates to a grid of 2^16 x 2^16 cells
+#define LANDMARK_MAGIC "ASTARLM" // first bytes of a landmark file (.alt)
+#define LANDMARK_SECTIONS 3 // landmark indices, distances from and distances to the landmarks
+#define DEFAULT_LANDMARKS 16 // number of landmarks for -L if none is given
+#define CH_MAGIC "ASTARCH" // first bytes of a contraction hierarchy file (.ch)
+#define CH_SECTIONS 5 // ranks, upward offsets and edges, downward offsets and edges
+#define CH_NO_MIDDLE UINT32_MAX // middle node of an edge which is no shortcut
+#define CH_WITNESS_HOPS 5 // edges of the longest witness path, a witness search does not go further
+#define CH_WITNESS_LIMIT 1000 // settled nodes after which a witness search gives up and a shortcut is added
+#define CH_EDGE_DIFFERENCE_WEIGHT 4 // weight of the edge difference in the priority of a node to contract
+#define ARENA_BLOCK_SIZE 65536 // bytes per block of an arena, larger requests get a block of their own
+#define ARENA_ALIGNMENT 16 // every allocation from an arena starts at a multiple of this
+#define SERVER_BACKLOG 64 // connections waiting in the listen queue of the server until it accepts them
+#define SERVER_MAX_CONNECTIONS 256 // open connections of the server, more are turned away
+#define SERVER_LINE_LIMIT 65536 // bytes of the longest request line, a connection sending a longer one is closed
+#define SERVER_IDLE_TIMEOUT 30 // seconds without a request after which the server closes a connection
+#define MATRIX_MAGIC "ASTARMX" // first bytes of a distance matrix written with -f binary
+#define ISOCHRONE_MAGIC "ASTARIS" // first bytes of isochrones written with -f binary
+#define PATH_MAGIC "ASTARPT" // first bytes of a route written with -f binary, see astar_write_path
+#define PATH_BUFFER_SIZE 65536 // bytes formatted by astar_write_path before they are written
+#define STATS_LINE_SIZE 512 // enough for the statistics of a route formatted by astar_format_stats
+#define CSV_CHUNKS_PER_THREAD 4 // a .csv is split into this many chunks per thread to balance the import
+#define ISOCHRONE_DEPOTS_PER_THREAD 4 // depots per thread of a block of isochrones which is kept until it is written
+#define HEAP_ARITY 4 // number of children per node in the d-ary heap of the OPEN set
+#define RADIX_SCALE 1000.0 // the radix heap works on fixed-point fscores in millimetres
+#define RADIX_BUCKETS 65 // one bucket for keys equal to the last popped key plus one per bit of the key
+
+// OPEN set implementation used when none is given on the command line
+// can be overridden at build time, e.g. -DDEFAULT_QUEUE=SORTED_LIST
+#ifndef DEFAULT_QUEUE
+#define DEFAULT_QUEUE DARY_HEAP
+#endif
 
 
 /////////////////////////////////////////////////////////////////////////////
 // STRUCTS
+// distance tables of the ALT heuristic
+// the tables are node major: the distances of node i to all landmarks are at [i*nr_of_landmarks ..]
+// -1 marks a node which can not be reached from (from_landmark) or can not reach (to_landmark) the landmark
+typedef struct {
+    unsigned long nr_of_landmarks;
+    uint32_t *indices; // node indices of the landmarks
+    float *from_landmark; // d(landmark, node)
+    float *to_landmark; // d(node, landmark)
+    void *mapping; // read-only mapping of the .alt file, NULL if the tables were built in memory
+    size_t mapping_size;
+} Landmarks;
+
+// edge of a contraction hierarchy
+// a shortcut stands for the two edges tail->middle and middle->head, middle is CH_NO_MIDDLE for an original edge
+typedef struct {
+    uint32_t node; // head of an upward edge, tail of a downward edge
+    float weight;
+    uint32_t middle;
+} ChEdge;
+
+// contraction hierarchy in CSR layout, nodes are contracted in the order of rank
+// node i has the upward edges i->up_edges[j].node for j in up_offsets[i] .. up_offsets[i+1]-1
+// and the downward edges down_edges[j].node->i for j in down_offsets[i] .. down_offsets[i+1]-1,
+// the other node of both always has a higher rank than i
+typedef struct {
+    unsigned long nr_of_nodes;
+    unsigned long nr_of_up_edges;
+    unsigned long nr_of_down_edges;
+    uint32_t *rank;
+    uint32_t *up_offsets;
+    ChEdge *up_edges;
+    uint32_t *down_offsets;
+    ChEdge *down_edges;
+    void *mapping; // read-only mapping of the .ch file, NULL if the hierarchy was built in memory
+    size_t mapping_size;
+} ContractionHierarchy;
+
+// header of the spatial index: a grid over the bounding box of the routable nodes (nodes with an edge)
+// it is followed by cell_offsets (columns*rows+1 entries) and cell_nodes (nr_of_indexed_nodes entries) in the
+// same allocation or section of the .bin, the nodes of cell c are cell_nodes[cell_offsets[c]] .. [cell_offsets[c+1]-1]
+// cell c is in row c/columns (south to north) and column c%columns (west to east)
+typedef struct {
+    double min_lat, min_lon; // south-west corner of the grid in degrees
+    double cell_lat, cell_lon; // size of a cell in degrees
+    uint32_t columns, rows;
+    uint32_t nr_of_indexed_nodes;
+    uint32_t reserved;
+} SpatialIndex;
+
+// graph in compressed sparse row layout
+// node i has the successors targets[offsets[i]] .. targets[offsets[i+1]-1]
+// the length of edge i is weights[i], computed once with the haversine distance when the graph is built
+// every node property has its own array so the search only touches what it needs
+typedef struct {
+    unsigned long nr_of_nodes;
+    unsigned long nr_of_edges;
+    uint64_t *ids; // node ids, only used to look up the index of an id
+    bool ids_sorted; // ids are in ascending order, false if the .csv is not sorted or the nodes were reordered
+    uint64_t fingerprint; // hash of the node order and the edges, stored in the graph file, see graph_fingerprint
+    // open addressing hash table from ids to indices with id_index_size slots (a power of two),
+    // empty slots are UINT32_MAX, see get_node_by_id
+    uint32_t *id_index;
+    unsigned long id_index_size;
+    double *lat, *lon; // node coordinates in degrees, NULL if the graph has fixed-point coordinates
+    int32_t *lat_e7, *lon_e7; // node coordinates in 1e-7 degrees, NULL if the graph has double coordinates
+    double *unit_x, *unit_y, *unit_z; // the coordinates as unit vectors for the distance kernels, see distance.c
+    uint32_t *offsets; // length nr_of_nodes+1
+    uint32_t *targets; // length nr_of_edges
+    float *weights; // length nr_of_edges, in metres
+    // reverse graph in the same layout for backward searches
+    // node i has the predecessors sources[reverse_offsets[i]] .. sources[reverse_offsets[i+1]-1]
+    uint32_t *reverse_offsets; // length nr_of_nodes+1
+    uint32_t *sources; // length nr_of_edges
+    float *reverse_weights; // length nr_of_edges
+    bool reverse_allocated; // the reverse graph was built after mapping a file without it
+    bool id_index_allocated; // the same for the id index
+    bool unit_vectors_allocated; // and for the unit vectors
+    SpatialIndex *spatial_index; // grid of the routable nodes for lookups by coordinates, see nearest_node
+    bool spatial_index_allocated; // built after mapping a file without it
+    Landmarks *landmarks; // only needed for the LANDMARKS heuristic, NULL otherwise
+    ContractionHierarchy *hierarchy; // only needed for the CONTRACTION_HIERARCHY algorithm, NULL otherwise
+    // if the graph was read from a binary file all arrays point into this read-only mapping of the file
+    // otherwise mapping is NULL and the arrays are allocated one by one
+    void *mapping;
+    size_t mapping_size;
+} Graph;
+
+// computes the air distances from the nodes indices[0..count-1] to one target node into distances
+typedef void (*DistanceKernel)(Graph *, const uint32_t *, unsigned long, unsigned long, double *);
+
+// order of the nodes in the .bin
+// ID_ORDER keeps the order of the .csv (ascending ids), the others renumber the nodes so that
+// nodes close in the road network are close in memory
+typedef char NodeOrder;
+enum nodeOrder {
+    ID_ORDER, HILBERT_ORDER, BFS_ORDER
+};
+
+// edges of a .csv in the order of the file, sorted into the CSR arrays once all are read
+typedef struct {
+    uint32_t *tails;
+    uint32_t *heads;
+    unsigned long size, capacity;
+} EdgeList;
+
+// newline aligned piece of a .csv, parsed by one thread
+typedef struct {
+    const char *start, *end;
+    const char *stop; // first line of the chunk which was not parsed, end if all were
+    Graph nodes; // the nodes of the chunk, only ids, lat and lon are used
+    unsigned long capacity; // of the node arrays
+    EdgeList edges;
+    bool misplaced_node; // the chunk stopped at a node line between the ways
+    bool too_large; // the chunk stopped because its nodes do not fit into the indices
+} CsvChunk;
+
+// state of a parallel .csv import, the threads take the chunks with an atomic cursor
+typedef struct {
+    CsvChunk *chunks;
+    unsigned long nr_of_chunks;
+    unsigned long next_chunk;
+    Graph *graph;
+} CsvImport;
+
+// sections of the binary graph file, the value is the slot in the section table
+typedef char GraphSection;
+enum graphSection {
+    SECTION_IDS, SECTION_LAT, SECTION_LON, SECTION_OFFSETS, SECTION_TARGETS, SECTION_WEIGHTS,
+    SECTION_REVERSE_OFFSETS, SECTION_SOURCES, SECTION_REVERSE_WEIGHTS, SECTION_ID_INDEX, SECTION_LAT_E7, SECTION_LON_E7,
+    SECTION_UNIT_X, SECTION_UNIT_Y, SECTION_UNIT_Z, SECTION_SPATIAL_INDEX
+};
+
+typedef struct {
+    uint64_t offset; // from the start of the file, a multiple of GRAPH_PAGE_SIZE, 0 if the section is missing
+    uint64_t size; // in bytes
+} GraphFileSection;
+
+// header of the binary graph file
+// all sections are page aligned and contain no pointers so the file can be mapped and used as it is
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t endianness;
+    uint64_t nr_of_nodes;
+    uint64_t nr_of_edges;
+    uint64_t flags; // GRAPH_IDS_SORTED
+    uint64_t fingerprint; // see graph_fingerprint
+    GraphFileSection sections[GRAPH_MAX_SECTIONS];
+} GraphFileHeader;
+
+// header of the landmark file, its sections are the arrays of Landmarks in the order of the struct
 typedef struct {
-    unsigned long id;
-    double lat, lon; //node coordinates
-    unsigned short nsucc; //number of node successors, i.e. length of successors
-    unsigned long *successors;
-} node;
+    char magic[8];
+    uint32_t version;
+    uint32_t endianness;
+    uint64_t nr_of_nodes; // the landmark file only fits the graph with these counts and this fingerprint
+    uint64_t nr_of_edges;
+    uint64_t fingerprint;
+    uint64_t nr_of_landmarks;
+    GraphFileSection sections[LANDMARK_SECTIONS];
+} LandmarkFileHeader;
+
+// header of the contraction hierarchy file, its sections are the arrays of ContractionHierarchy in the order of the struct
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t endianness;
+    uint64_t nr_of_nodes; // the hierarchy file only fits the graph with these counts and this fingerprint
+    uint64_t nr_of_edges;
+    uint64_t fingerprint;
+    uint64_t nr_of_up_edges;
+    uint64_t nr_of_down_edges;
+    GraphFileSection sections[CH_SECTIONS];
+} ChFileHeader;
 
 typedef char Queue;
 enum whichQueue {
@@ -35,61 +260,537 @@ enum whichQueue {
 };
 
 
+// state of a node in one search, packed into 8 bytes so the status list of a large graph stays in the caches
+// h is not stored: it is computed when a node is reached and only lives on in the key of the node in the queue
 typedef struct {
-    double g, h;
-    unsigned long parent;
-    Queue whq;
+    float g; // distance from the start
+    unsigned int parent : 30; // NO_PARENT for the start
+    unsigned int whq : 2; // Queue
 } AStarStatus;
 
+// block of an arena, the data follows the header
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t size; // of the data
+} ArenaBlock;
+
+// memory which is given back all at once, see arena.c
+// the blocks before current are in use, the blocks after it are kept from before the last reset
+typedef struct {
+    ArenaBlock *first;
+    ArenaBlock *current; // NULL if nothing was allocated since the last reset
+    size_t used; // bytes of the current block in use
+} Arena;
+
 typedef struct list_elem {
     unsigned long index;
+    double key;
     struct list_elem *next;
 } list_elem;
 
+typedef char QueueType;
+enum queueType {
+    DARY_HEAP, SORTED_LIST, RADIX_HEAP
+};
+
+typedef struct {
+    float key; // fscore of the node at the time it was pushed or decreased
+    uint32_t index;
+} heap_elem;
+
+typedef struct {
+    unsigned long key; // fscore in millimetres
+    unsigned long index;
+} radix_elem;
+
+typedef struct {
+    radix_elem *elems;
+    unsigned long size, capacity;
+} radix_bucket;
+
+typedef struct {
+    QueueType type;
+    unsigned long size; // number of elements currently in the queue
+    // DARY_HEAP: heap array with room for every node and the position of every node in it
+    // (indexed like the status list, only valid while the node is OPEN)
+    heap_elem *heap;
+    uint32_t *position;
+    // SORTED_LIST: the old sorted linked list
+    // its elements come from the arena, removed elements are kept in free_elems for the next insertion
+    // list_elem_of is the element of every node in the list (indexed like position), so queue_key needs no walk
+    list_elem *list;
+    list_elem **list_elem_of;
+    list_elem *free_elems;
+    Arena list_arena;
+    // RADIX_HEAP: buckets by highest bit that differs from the last popped key
+    // position is the position inside the bucket and bucket_of the bucket of every node in the queue
+    radix_bucket buckets[RADIX_BUCKETS];
+    unsigned char *bucket_of;
+    unsigned long last_key;
+    double popped_key; // key of the node popped last
+    // operations since the start of the search, see reset_workspace
+    unsigned long pushes, decrease_keys, pops;
+    unsigned long max_size;
+} PriorityQueue;
+
+// counters of one search, cheap enough to be always on: plain increments in the workspace of the thread
+// the operations on the OPEN set are counted by the queue, collect_stats sums everything up
+typedef struct {
+    unsigned long settled_nodes; // nodes taken from the OPEN set and closed
+    unsigned long relaxed_edges; // edges looked at from the settled nodes
+    unsigned long reopened_nodes; // CLOSED nodes put back into the OPEN set by a shorter path
+    unsigned long heuristic_evaluations;
+    unsigned long pushes, decrease_keys, pops;
+    unsigned long max_open_size;
+} SearchStats;
+
+// everything a search needs besides the graph, can be reused for many searches
+typedef struct {
+    unsigned long nr_of_nodes;
+    AStarStatus *status_list;
+    // status_list[i] is only valid if generation[i]==current_generation, otherwise node i is NONE
+    // so a new search only has to increase current_generation instead of clearing the status list
+    unsigned int *generation;
+    unsigned int current_generation;
+    PriorityQueue open_queue;
+    SearchStats stats; // counters of the last search but the queue operations
+} SearchWorkspace;
+
+// edges of one node in the remaining graph while the contraction hierarchy is built
+typedef struct {
+    ChEdge *edges;
+    uint32_t size, capacity;
+} ChAdjacency;
+
+// a shortcut found for the contraction of a node, see find_shortcuts
+typedef struct {
+    uint32_t tail, head;
+    float weight;
+} ChShortcut;
+
+// state of the contraction
+// out[i] and in[i] are the outgoing and incoming edges of node i, ChEdge.node being the other node;
+// a contracted node is removed from the lists of its neighbours but keeps its own (upward) lists
+typedef struct {
+    ChAdjacency *out;
+    ChAdjacency *in;
+    unsigned long nr_of_nodes;
+    unsigned int *deleted_neighbours; // number of contracted neighbours, part of the priority
+    unsigned int *depth; // longest chain of contracted nodes below a node, part of the priority
+    uint8_t *hops; // edges of the path of every node reached by the witness search
+    ChShortcut *shortcuts; // the shortcuts of the node whose priority was computed last
+    unsigned long nr_of_shortcuts;
+    unsigned long shortcut_capacity;
+    // the heads of the possible shortcuts of a witness search have target_stamp[i]==current_stamp
+    unsigned int *target_stamp;
+    unsigned int current_stamp;
+    SearchWorkspace witness;
+} ChBuilder;
+
 typedef char Heuristic;
 enum heuristic {
-    HAVERSINE, EQUIRECTANGULAR
+    HAVERSINE, EQUIRECTANGULAR, LANDMARKS
+};
+
+typedef char Algorithm;
+enum algorithm {
+    UNIDIRECTIONAL, BIDIRECTIONAL, CONTRACTION_HIERARCHY
+};
+
+// how routes are searched, chosen on the command line
+typedef struct {
+    Heuristic distance_method;
+    QueueType queue_type;
+    Algorithm algorithm;
+} SearchOptions;
+
+// a route from start to goal
+typedef struct {
+    unsigned long nr_of_nodes;
+    unsigned long capacity;
+    unsigned long *indices; // node indices from start to goal
+    double *distances; // distance from the start to each node
+    double length;
+} Path;
+
+// everything one query needs besides the graph
+// a thread answering many queries keeps one context, nothing is allocated again between queries:
+// the workspaces are reset with their generations, the scratch memory of a query by resetting its arena
+typedef struct {
+    SearchWorkspace forward;
+    SearchWorkspace backward; // only allocated for the bidirectional and the contraction hierarchy search
+    Path path;
+    Arena scratch; // temporary memory of one query, e.g. the shortcuts of a hierarchy path before unpacking
+} QueryContext;
+
+// shared state of the worker threads computing a distance matrix, see distance_matrix
+typedef struct {
+    Graph *graph;
+    QueueType queue_type;
+    uint32_t *sources; // node indices, one row each
+    unsigned long nr_of_sources;
+    unsigned long nr_of_targets; // columns of the matrix
+    uint32_t *target_columns; // first column of every target node, UINT32_MAX for the other nodes
+    uint32_t *first_columns; // first column of the node of every column, the column itself unless it is repeated
+    unsigned long nr_of_distinct_targets; // a search stops after settling this many targets
+    double *distances;
+    unsigned long next_source; // cursor over the sources, only changed atomically
+} MatrixContext;
+
+// output of the command line tool (-f), text is csv for the distance matrix and the isochrones,
+// which have no JSON output
+typedef char OutputFormat;
+enum outputFormat {
+    TEXT_OUTPUT, JSON_OUTPUT, BINARY_OUTPUT
+};
+
+// the destination of a route being formatted, see output.c
+typedef struct {
+    char *buffer;
+    size_t size;
+    size_t used; // bytes of the buffer not yet written
+    size_t total; // bytes of the whole output so far, also the ones which did not fit into a caller's buffer
+    FILE *file; // a full buffer is written here, NULL for a caller's buffer which just stops filling up
+    bool failed; // a write to the file went wrong
+} PathWriter;
+
+// the nodes reached from one depot, copied out of the query handle of its worker
+typedef struct {
+    uint64_t *ids; // by ascending distance
+    double *distances;
+    unsigned long nr_of_nodes;
+    unsigned long capacity; // of ids and distances, they are reused by the depots of later blocks
+} Isochrone;
+
+// shared state of the worker threads computing the isochrones of many depots, see run_isochrones
+typedef struct {
+    AStarQuery **routers; // one query handle per worker
+    unsigned long next_worker; // hands out the handles, only changed atomically
+    uint64_t *depots;
+    Isochrone *isochrones; // one per depot of the current block
+    unsigned long nr_of_depots;
+    unsigned long first_depot, end_depot; // the current block
+    unsigned long next_depot; // cursor over the depots of the block, only changed atomically
+    double max_distance;
+    float *binary_distances; // distances of the isochrone written with -f binary, as floats for one fwrite
+    unsigned long binary_capacity;
+} IsochroneContext;
+
+// statistics of every route written by the command line tool (-s)
+typedef char StatsOutput;
+enum statsOutput {
+    NO_STATS, TEXT_STATS, JSON_STATS
 };
 
+// one routing query of a batch and its answer
+typedef struct {
+    unsigned long node_start, node_goal;
+    double path_length; // -1 if there is no path
+    unsigned long nr_of_path_nodes;
+    double milliseconds;
+    AStarStats stats;
+} BatchQuery;
+
+// shared state of the worker threads answering a batch
+typedef struct {
+    AStarGraph *graph;
+    BatchQuery *queries;
+    unsigned long nr_of_queries;
+    unsigned long next_query; // cursor over the queries, only changed atomically
+    AStarQuery **routers; // one query handle per worker
+    AStarQuery **references; // one unidirectional A* handle per worker if verify is set
+    unsigned long next_worker; // hands out the handles, only changed atomically
+    bool verify; // also run the unidirectional search and compare the lengths
+    bool collect_stats; // keep the statistics of every route in its query
+    unsigned long nr_of_mismatches;
+} BatchContext;
+
+// state of a connection of the server, only its owner touches it: a worker while it is busy, run_server otherwise
+typedef char ConnectionState;
+enum connectionState {
+    CONNECTION_FREE, // the slot has no connection
+    CONNECTION_IDLE, // run_server polls it for the next request
+    CONNECTION_QUEUED, // it has a request and waits for a worker
+    CONNECTION_BUSY, // a worker answers one request of it
+    CONNECTION_CLOSING // a too long line was answered, run_server drops what comes until the client closes it
+};
+
+typedef struct {
+    int socket;
+    ConnectionState state;
+    char *input; // received bytes which are not answered yet, at most SERVER_LINE_LIMIT
+    size_t capacity, used;
+    size_t dropped; // bytes dropped while closing
+    time_t last_active; // seconds of CLOCK_MONOTONIC when it was accepted or sent something
+} ServerConnection;
+
+// shared state of the worker threads of the server, see run_server
+typedef struct {
+    AStarQuery **routers; // one query handle per worker
+    unsigned long next_worker; // hands out the handles, only changed atomically
+    StatsOutput stats_output; // the answers have the statistics of the route unless NO_STATS
+    ServerConnection connections[SERVER_MAX_CONNECTIONS];
+    unsigned long ready[SERVER_MAX_CONNECTIONS]; // queued connections in the order they got a request, a ring buffer
+    unsigned long first_ready, nr_of_ready;
+    bool stopping;
+    pthread_mutex_t lock; // protects the states, the ready ring and stopping
+    pthread_cond_t connection_ready;
+} ServerContext;
+
 
 /////////////////////////////////////////////////////////////////////////////
 // METHODS
 
-//functions in parser.h
-unsigned long read_csv_file(char *, node **);
+//functions in parser.c
+int read_csv_file(const char *, Graph *, unsigned int, NodeOrder, bool);
+
+bool get_node(const char *, const char *, Graph *, unsigned long *);
+
+void add_edge(EdgeList *, unsigned long, unsigned long);
+
+void get_edges(const char *, const char *, Graph *, EdgeList *);
+
+int build_edges(Graph *, CsvChunk *, unsigned long);
+
+int read_binary_file(const char *, Graph *);
+
+int write_sections(FILE *, void *, size_t, GraphFileSection *, void **, uint64_t *, int);
+
+int map_file(const char *, size_t, void **, size_t *);
+
+void *map_optional_section(void *, size_t, GraphFileSection *, uint64_t, bool *);
+
+void *map_section(void *, size_t, GraphFileSection *, uint64_t, bool *);
+
+int write_binary_file(const char *, Graph *);
+
+void free_graph(Graph *);
+
 
-unsigned long get_nr_of_nodes(char *);
+// functions in graph.c
+uint64_t graph_fingerprint(Graph *);
 
-void get_nodes(char *, node **, unsigned long);
+void build_reverse_graph(Graph *);
 
-unsigned long get_next_edge_node(char **, const char *);
+unsigned long id_index_size(unsigned long);
 
-void get_edges(FILE *, char *, const char *, node **, unsigned long, bool, unsigned int *);
+void build_id_index(Graph *);
 
-void add_edge(node **, unsigned long, unsigned long, unsigned int);
+void reorder_graph(Graph *, NodeOrder);
 
-unsigned long read_binary_file(char *, node **);
+void to_fixed_coordinates(Graph *);
 
-void write_binary_file(char *, node *, unsigned long);
+bool parse_node_order(const char *, NodeOrder *);
 
-void build_edges(char *, node **, unsigned long, unsigned int *);
+uint64_t spatial_index_size(SpatialIndex *);
+
+void build_spatial_index(Graph *);
+
+unsigned long nearest_node(Graph *, double, double, double *);
 
 
 // functions in astar.c
-unsigned long get_node_by_id(node *, unsigned long, unsigned long);
+unsigned long get_node_by_id(Graph *, unsigned long);
+
+unsigned long search_sorted_ids(Graph *, unsigned long);
+
+unsigned long search_id_index(Graph *, unsigned long);
+
+double heuristic_distance(unsigned long, unsigned long, Graph *, Heuristic distance_method);
+
+double haversine_distance(unsigned long, unsigned long, Graph *);
+
+double equirectangular_distance(unsigned long, unsigned long, Graph *);
+
+void init_workspace(SearchWorkspace *, unsigned long, QueueType);
+
+void free_workspace(SearchWorkspace *);
+
+void reset_workspace(SearchWorkspace *);
+
+bool astar_search(unsigned long, unsigned long, Graph *, SearchWorkspace *, Heuristic);
+
+void init_path(Path *);
+
+void free_path(Path *);
+
+void append_to_path(Path *, unsigned long, double);
+
+void get_path(unsigned long, AStarStatus *, Path *);
+
+void init_query_context(QueryContext *, Graph *, SearchOptions *);
+
+void free_query_context(QueryContext *);
+
+int find_route(unsigned long, unsigned long, Graph *, SearchOptions *, QueryContext *);
+
+void collect_stats(QueryContext *, SearchStats *);
+
+bool parse_algorithm(const char *, Algorithm *);
+
+bool parse_heuristic(const char *, Heuristic *);
+
+
+// functions in arena.c
+void arena_init(Arena *);
+
+void *arena_alloc(Arena *, size_t);
+
+void arena_reset(Arena *);
+
+void arena_free(Arena *);
+
+
+// functions in distance.c
+void build_unit_vectors(Graph *);
+
+double chord_distance(unsigned long, unsigned long, Graph *);
+
+void chord_distances_scalar(Graph *, const uint32_t *, unsigned long, unsigned long, double *);
+
+#if defined(__x86_64__)
+void chord_distances_sse2(Graph *, const uint32_t *, unsigned long, unsigned long, double *);
+
+void chord_distances_avx2(Graph *, const uint32_t *, unsigned long, unsigned long, double *);
+#endif
+
+DistanceKernel distance_kernel(void);
+
+void heuristic_batch(const uint32_t *, unsigned long, unsigned long, Graph *, Heuristic, double *);
+
+
+// functions in bidirectional.c
+bool bidirectional_search(unsigned long, unsigned long, Graph *, SearchWorkspace *, SearchWorkspace *, Heuristic,
+                          Path *);
+
+
+// functions in queue.c
+void add_element_to_list(PriorityQueue *, unsigned long, double);
 
-double heuristic_distance(unsigned long, unsigned long, node *, Heuristic distance_method);
+bool remove_element_from_list(PriorityQueue *, unsigned long);
 
-double haversine_distance(unsigned long, unsigned long, node *);
+void queue_init(PriorityQueue *, QueueType, unsigned long);
 
-double equirectangular_distance(unsigned long, unsigned long, node *);
+void queue_free(PriorityQueue *);
 
-void astar(unsigned long, unsigned long, node *, unsigned long, Heuristic, char *);
+void queue_clear(PriorityQueue *);
 
-double get_fscore(AStarStatus);
+bool queue_is_empty(PriorityQueue *);
 
-void add_element_to_list(unsigned long, list_elem **, AStarStatus *);
+void queue_push(PriorityQueue *, unsigned long, double);
 
-void remove_element_from_list(unsigned long, list_elem **);
+void queue_decrease_key(PriorityQueue *, unsigned long, double);
 
-void write_solution_to_file(char* , unsigned long , node* , AStarStatus* );
+double queue_key(PriorityQueue *, unsigned long);
+
+double queue_min_key(PriorityQueue *);
+
+unsigned long queue_pop(PriorityQueue *);
+
+bool parse_queue_type(const char *, QueueType *);
+
+
+// functions in dijkstra.c
+unsigned long dijkstra(unsigned long, Graph *, SearchWorkspace *, bool, double, uint32_t *);
+
+unsigned long dijkstra_to_targets(unsigned long, Graph *, SearchWorkspace *, uint32_t *, unsigned long, double *);
+
+void distance_matrix(Graph *, QueueType, uint32_t *, unsigned long, uint32_t *, unsigned long, unsigned int,
+                     double *);
+
+
+// functions in landmarks.c
+void build_landmarks(Graph *, unsigned long, QueueType, Landmarks *);
+
+int write_landmark_file(const char *, Graph *, Landmarks *);
+
+int read_landmark_file(const char *, Graph *, Landmarks *);
+
+void free_landmarks(Landmarks *);
+
+double landmark_distance(unsigned long, unsigned long, Graph *);
+
+
+// functions in ch.c
+unsigned long build_contraction_hierarchy(Graph *, ContractionHierarchy *);
+
+int write_hierarchy_file(const char *, Graph *, ContractionHierarchy *);
+
+int read_hierarchy_file(const char *, Graph *, ContractionHierarchy *);
+
+void free_hierarchy(ContractionHierarchy *);
+
+int hierarchy_search(unsigned long, unsigned long, Graph *, SearchWorkspace *, SearchWorkspace *, Arena *, Path *);
+
+
+// functions in parallel.c
+double elapsed_milliseconds(struct timespec, struct timespec);
+
+void run_parallel(unsigned int, void *(*)(void *), void *);
+
+
+// functions in batch.c (command line tool only)
+BatchQuery *read_queries(char *, unsigned long *);
+
+AStarCode run_batch(char *, AStarGraph *, const AStarOptions *, unsigned int, bool, StatsOutput);
+
+
+// functions in matrix.c (command line tool only)
+uint64_t *read_ids(char *, unsigned long *);
+
+AStarCode run_matrix(char *, char *, AStarGraph *, const AStarOptions *, unsigned int, OutputFormat);
+
+
+// functions in isochrone.c (command line tool only)
+AStarCode run_isochrones(char *, double, AStarGraph *, const AStarOptions *, unsigned int, OutputFormat);
+
+
+// functions in server.c (command line tool only)
+AStarCode run_server(const char *, AStarGraph *, const AStarOptions *, unsigned int, StatsOutput);
+
+
+/////////////////////////////////////////////////////////////////////////////
+// INLINE HELPERS
+
+static inline uint64_t id_hash(uint64_t id) {
+    // mixes the bits of a node id for the id index, consecutive ids end up in scattered slots
+    id *= 0x9E3779B97F4A7C15ULL;
+    return id ^ (id >> 32);
+}
+
+static inline double node_lat(Graph *graph, unsigned long index) {
+    // returns the latitude of a node in degrees from whichever coordinates the graph has
+    return graph->lat_e7 != NULL ? graph->lat_e7[index] / COORDINATE_SCALE : graph->lat[index];
+}
+
+static inline double node_lon(Graph *graph, unsigned long index) {
+    // the same for the longitude
+    return graph->lon_e7 != NULL ? graph->lon_e7[index] / COORDINATE_SCALE : graph->lon[index];
+}
+
+static inline AStarStatus *get_status(SearchWorkspace *workspace, unsigned long index) {
+    // returns the status of a node in the current search
+    // a node seen for the first time in this search is turned into NONE
+    if (workspace->generation[index] != workspace->current_generation) {
+        workspace->generation[index] = workspace->current_generation;
+        workspace->status_list[index].whq = NONE;
+    }
+    return &workspace->status_list[index];
+}
+
+static inline uint32_t *cell_offsets(SpatialIndex *spatial_index) {
+    // the offsets of the cells follow the header of the spatial index
+    return (uint32_t *) (spatial_index + 1);
+}
+
+static inline uint32_t *cell_nodes(SpatialIndex *spatial_index) {
+    // and the nodes of the cells follow the offsets
+    return cell_offsets(spatial_index) + (uint64_t) spatial_index->columns * spatial_index->rows + 1;
+}
+
+static inline bool is_reached(SearchWorkspace *workspace, unsigned long index) {
+    // returns true if the node is OPEN or CLOSED in the current search
+    return workspace->generation[index] == workspace->current_generation && workspace->status_list[index].whq != NONE;
+}
+
+#endif //ASTAR_ASTAR_H
@@ -0,0 +1,192 @@
+// batch.c
+// answers many routing queries against one loaded graph, optionally with a pool of worker threads
+// part of the command line tool, it only uses the library interface of libastar.h
+
+
+#include "astar.h"
+
+static bool same_length(double a, double b)
+{
+    // two path lengths are the same if they differ by less than a centimetre or rounding of the float edge lengths
+    return fabs(a-b)<=0.01+1e-6*fabs(a);
+}
+
+static void* batch_worker(void* argument)
+{
+    // takes the next unanswered query of the batch until all are answered
+    // every worker has its own query handles, the graph is only read
+
+    BatchContext* batch = argument;
+    BatchQuery* query;
+    unsigned long worker = __sync_fetch_and_add(&batch->next_worker, 1);
+    AStarQuery* router = batch->routers[worker];
+    AStarQuery* reference = batch->verify ? batch->references[worker] : NULL;
+    AStarPath path;
+    AStarCode code;
+    unsigned long query_index;
+    double reference_length;
+    struct timespec query_start, query_end;
+
+    while ((query_index = __sync_fetch_and_add(&batch->next_query, 1))<batch->nr_of_queries) {
+        query = &batch->queries[query_index];
+
+        clock_gettime(CLOCK_MONOTONIC, &query_start);
+        code = astar_route(router, query->node_start, query->node_goal, &path);
+        query->path_length = path.length;
+        query->nr_of_path_nodes = path.nr_of_nodes;
+        clock_gettime(CLOCK_MONOTONIC, &query_end);
+        query->milliseconds = elapsed_milliseconds(query_start, query_end);
+        if (batch->collect_stats) astar_query_stats(router, &query->stats);
+
+        if (batch->verify && code!=ASTAR_UNKNOWN_NODE) {
+            astar_route(reference, query->node_start, query->node_goal, &path);
+            reference_length = path.length;
+            if (!same_length(query->path_length, reference_length)) {
+                fprintf(stderr, "Mismatch for %lu %lu: %.2f, unidirectional A* found %.2f\n", query->node_start,
+                        query->node_goal, query->path_length, reference_length);
+                __sync_fetch_and_add(&batch->nr_of_mismatches, 1);
+            }
+        }
+    }
+    return NULL;
+}
+
+static int compare_doubles(const void* a, const void* b)
+{
+    double x = *(const double*) a;
+    double y = *(const double*) b;
+    return (x>y)-(x<y);
+}
+
+static double percentile(double* sorted_values, unsigned long n, double p)
+{
+    // nearest-rank percentile of ascending sorted values, p in (0, 100]
+    unsigned long rank = (unsigned long) ceil(p/100.0*n);
+    if (rank==0) rank = 1;
+    return sorted_values[rank-1];
+}
+
+BatchQuery* read_queries(char* queries_filename, unsigned long* nr_of_queries)
+{
+    // reads pairs of source and goal node ids from queries_filename (one pair per line, '-' for stdin)
+    // empty lines and lines starting with # are skipped
+    // returns the queries and sets nr_of_queries, or NULL if the file can not be opened
+
+    FILE* fin;
+    char* buffer = NULL;
+    size_t characters = 0;
+    unsigned long node_start, node_goal;
+    unsigned long capacity = 1024;
+    BatchQuery* queries = malloc(capacity*sizeof(BatchQuery));
+
+    if (queries==NULL) exit(1);
+    if (strcmp(queries_filename, "-")==0) {
+        fin = stdin;
+    }
+    else if ((fin = fopen(queries_filename, "r"))==NULL) {
+        free(queries);
+        return NULL;
+    }
+
+    *nr_of_queries = 0;
+    while (getline(&buffer, &characters, fin)!=-1) {
+        if (buffer[0]=='#' || sscanf(buffer, "%lu %lu", &node_start, &node_goal)!=2) continue;
+        if (*nr_of_queries==capacity) {
+            capacity *= 2;
+            if ((queries = realloc(queries, capacity*sizeof(BatchQuery)))==NULL) exit(1);
+        }
+        queries[*nr_of_queries].node_start = node_start;
+        queries[*nr_of_queries].node_goal = node_goal;
+        (*nr_of_queries)++;
+    }
+
+    free(buffer);
+    if (fin!=stdin) fclose(fin);
+    return queries;
+}
+
+AStarCode run_batch(char* queries_filename, AStarGraph* graph, const AStarOptions* options,
+        unsigned int nr_of_threads, bool verify, StatsOutput stats_output)
+{
+    // answers all queries of queries_filename (see read_queries) with nr_of_threads worker threads
+    // and writes one line per query to stdout, in the order of the input:
+    //      source_node_id goal_node_id path_length nr_of_path_nodes milliseconds
+    // path_length is -1 and nr_of_path_nodes 0 if an id is unknown or there is no path
+    // each worker reuses one query handle for all of its queries, it is reset by its generation counters
+    // the throughput and latency percentiles of the whole batch are written to stderr
+    // with verify every length is compared with the one of the unidirectional A*, the mismatches go to stderr
+    // with stats_output the statistics of every route follow on stderr, one line per query in the same order:
+    //      source_node_id goal_node_id statistics  OR  {"source":id,"goal":id,"stats":{...}}
+    // returns the code of astar_query_create, ASTAR_OPEN_ERROR if the queries can not be read or ASTAR_FAILURE if
+    // there are mismatches
+
+    AStarOptions reference_options = *options;
+    BatchContext batch = {.graph=graph, .verify=verify, .collect_stats=stats_output!=NO_STATS, .next_query=0,
+                          .next_worker=0, .nr_of_mismatches=0};
+    struct timespec batch_start, batch_end;
+    double batch_milliseconds;
+    double* latencies;
+    char stats_line[STATS_LINE_SIZE];
+    AStarCode code = ASTAR_OK;
+
+    // the handles are created up front, so an option the graph does not support fails before any query
+    reference_options.algorithm = "astar";
+    batch.routers = calloc(nr_of_threads, sizeof(AStarQuery*));
+    batch.references = calloc(nr_of_threads, sizeof(AStarQuery*));
+    if (batch.routers==NULL || batch.references==NULL) exit(1);
+    for (unsigned int i = 0; i<nr_of_threads && code==ASTAR_OK; ++i) {
+        code = astar_query_create(graph, options, &batch.routers[i]);
+        if (code==ASTAR_OK && verify) code = astar_query_create(graph, &reference_options, &batch.references[i]);
+    }
+
+    if (code==ASTAR_OK && (batch.queries = read_queries(queries_filename, &batch.nr_of_queries))==NULL) {
+        code = ASTAR_OPEN_ERROR;
+    }
+    if (code==ASTAR_OK) {
+        clock_gettime(CLOCK_MONOTONIC, &batch_start);
+        run_parallel(nr_of_threads, batch_worker, &batch);
+        clock_gettime(CLOCK_MONOTONIC, &batch_end);
+        batch_milliseconds = elapsed_milliseconds(batch_start, batch_end);
+
+        for (unsigned long i = 0; i<batch.nr_of_queries; ++i) {
+            printf("%lu %lu %.2f %lu %.3f\n", batch.queries[i].node_start, batch.queries[i].node_goal,
+                    batch.queries[i].path_length, batch.queries[i].nr_of_path_nodes, batch.queries[i].milliseconds);
+        }
+        for (unsigned long i = 0; i<batch.nr_of_queries && stats_output!=NO_STATS; ++i) {
+            astar_format_stats(&batch.queries[i].stats, stats_output==JSON_STATS, stats_line, sizeof(stats_line));
+            if (stats_output==JSON_STATS) {
+                fprintf(stderr, "{\"source\":%lu,\"goal\":%lu,\"stats\":%s}\n", batch.queries[i].node_start,
+                        batch.queries[i].node_goal, stats_line);
+            }
+            else {
+                fprintf(stderr, "%lu %lu %s\n", batch.queries[i].node_start, batch.queries[i].node_goal, stats_line);
+            }
+        }
+
+        fprintf(stderr, "Answered %lu queries in %.3f ms with %u thread(s), %.1f queries/s.\n", batch.nr_of_queries,
+                batch_milliseconds, nr_of_threads, batch.nr_of_queries/(batch_milliseconds*1e-3));
+        if (batch.nr_of_queries>0) {
+            if ((latencies = malloc(batch.nr_of_queries*sizeof(double)))==NULL) exit(1);
+            for (unsigned long i = 0; i<batch.nr_of_queries; ++i) latencies[i] = batch.queries[i].milliseconds;
+            qsort(latencies, batch.nr_of_queries, sizeof(double), compare_doubles);
+            fprintf(stderr, "Latency in ms: p50 %.3f | p90 %.3f | p99 %.3f | max %.3f\n",
+                    percentile(latencies, batch.nr_of_queries, 50), percentile(latencies, batch.nr_of_queries, 90),
+                    percentile(latencies, batch.nr_of_queries, 99), latencies[batch.nr_of_queries-1]);
+            free(latencies);
+        }
+        free(batch.queries);
+
+        if (verify) {
+            fprintf(stderr, "Verified against unidirectional A*: %lu mismatch(es).\n", batch.nr_of_mismatches);
+            if (batch.nr_of_mismatches>0) code = ASTAR_FAILURE;
+        }
+    }
+
+    for (unsigned int i = 0; i<nr_of_threads; ++i) {
+        astar_query_free(batch.routers[i]);
+        astar_query_free(batch.references[i]);
+    }
+    free(batch.routers);
+    free(batch.references);
+    return code;
+}
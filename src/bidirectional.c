@@ -0,0 +1,138 @@
+// bidirectional.c
+// bidirectional A*: a forward search from the start on the successors and a backward search from the goal
+// on the predecessors (reverse graph) which meet in the middle
+
+
+#include "astar.h"
+
+static double potential(unsigned long index, unsigned long start_index, unsigned long goal_index, Graph* graph,
+        Heuristic distance_method)
+{
+    // average of the forward heuristic (to the goal) and the negated backward heuristic (from the start)
+    // the forward search uses it as h, the backward search its negation
+    // both are consistent if the heuristic is, which makes the stopping criterion below correct
+    return (heuristic_distance(index, goal_index, graph, distance_method)-
+            heuristic_distance(start_index, index, graph, distance_method))*0.5;
+}
+
+bool bidirectional_search(unsigned long start_index, unsigned long goal_index, Graph* graph, SearchWorkspace* forward,
+        SearchWorkspace* backward, Heuristic distance_method, Path* path)
+{
+    // runs the forward search in the forward workspace and the backward search in the backward workspace
+    // alternating one expansion each
+    // every edge relaxation reaching a node already reached by the other direction gives a candidate path
+    // the search stops as soon as the keys (g+h) of the last expanded nodes of both directions add up
+    // to at least the best candidate, no shorter path can be found after that
+    // returns true if a path is found, it is then written to path (start to goal)
+
+    SearchWorkspace* workspaces[2] = {forward, backward};
+    SearchWorkspace* workspace;
+    SearchWorkspace* other;
+    double last_key[2] = {0, 0};
+    double best_length = DBL_MAX;
+    unsigned long meeting_index = ULONG_MAX;
+    int direction = 0; // 0 forward, 1 backward
+
+    AStarStatus* current;
+    AStarStatus* successor;
+    unsigned long current_index;
+    unsigned long node_successor_index;
+    float successor_current_cost;
+    double candidate_length;
+    double successor_potential;
+    uint32_t* edge_offsets;
+    uint32_t* edge_heads;
+    float* edge_weights;
+
+    reset_workspace(forward);
+    reset_workspace(backward);
+
+    current = get_status(forward, start_index);
+    current->g = 0;
+    current->parent = NO_PARENT;
+    current->whq = OPEN;
+    queue_push(&forward->open_queue, start_index, potential(start_index, start_index, goal_index, graph, distance_method));
+
+    current = get_status(backward, goal_index);
+    current->g = 0;
+    current->parent = NO_PARENT;
+    current->whq = OPEN;
+    queue_push(&backward->open_queue, goal_index, -potential(goal_index, start_index, goal_index, graph, distance_method));
+    forward->stats.heuristic_evaluations += 2;
+    backward->stats.heuristic_evaluations += 2;
+
+    if (start_index==goal_index) {
+        best_length = 0;
+        meeting_index = start_index;
+    }
+
+    while (!queue_is_empty(&forward->open_queue) && !queue_is_empty(&backward->open_queue)) {
+        workspace = workspaces[direction];
+        other = workspaces[1-direction];
+
+        current_index = queue_pop(&workspace->open_queue);
+        current = &workspace->status_list[current_index];
+        last_key[direction] = workspace->open_queue.popped_key;
+        if (last_key[0]+last_key[1]>=best_length) break;
+        current->whq = CLOSED;
+        workspace->stats.settled_nodes++;
+
+        if (direction==0) {
+            edge_offsets = graph->offsets;
+            edge_heads = graph->targets;
+            edge_weights = graph->weights;
+        }
+        else {
+            edge_offsets = graph->reverse_offsets;
+            edge_heads = graph->sources;
+            edge_weights = graph->reverse_weights;
+        }
+
+        workspace->stats.relaxed_edges += edge_offsets[current_index+1]-edge_offsets[current_index];
+        for (uint32_t i = edge_offsets[current_index]; i<edge_offsets[current_index+1]; ++i) {
+            node_successor_index = edge_heads[i];
+            successor_current_cost = current->g+edge_weights[i];
+
+            if (is_reached(other, node_successor_index)) {
+                candidate_length = successor_current_cost+other->status_list[node_successor_index].g;
+                if (candidate_length<best_length) {
+                    best_length = candidate_length;
+                    meeting_index = node_successor_index;
+                }
+            }
+
+            successor = get_status(workspace, node_successor_index);
+            if (successor->whq==OPEN) {
+                if (successor->g<=successor_current_cost) continue;
+                queue_decrease_key(&workspace->open_queue, node_successor_index,
+                        queue_key(&workspace->open_queue, node_successor_index)-(successor->g-successor_current_cost));
+                successor->g = successor_current_cost;
+                successor->parent = current_index;
+                continue;
+            }
+            if (successor->whq==CLOSED) {
+                if (successor->g<=successor_current_cost) continue;
+                workspace->stats.reopened_nodes++;
+            }
+            successor->g = successor_current_cost;
+            successor->parent = current_index;
+            successor->whq = OPEN;
+            successor_potential = potential(node_successor_index, start_index, goal_index, graph, distance_method);
+            workspace->stats.heuristic_evaluations += 2;
+            if (direction==1) successor_potential = -successor_potential;
+            queue_push(&workspace->open_queue, node_successor_index, successor_current_cost+successor_potential);
+        }
+        direction = 1-direction;
+    }
+
+    if (meeting_index==ULONG_MAX) return false;
+
+    // start .. meeting node from the forward parents, then meeting node .. goal from the backward parents
+    get_path(meeting_index, forward->status_list, path);
+    for (unsigned long index = backward->status_list[meeting_index].parent; index!=NO_PARENT;
+            index = backward->status_list[index].parent) {
+        append_to_path(path, index, best_length-backward->status_list[index].g);
+    }
+    path->length = best_length;
+    return true;
+}
@@ -0,0 +1,568 @@
+// ch.c
+// contraction hierarchies
+// the nodes are contracted one after the other in the order of a priority, for every contracted node
+// shortcuts between its remaining neighbours keep the distances intact unless a witness path exists
+// a query is a bidirectional dijkstra which only goes upwards in the order and meets at the highest node,
+// shortcuts are unpacked into the original edges afterwards
+
+
+#include "astar.h"
+
+static ChEdge* find_edge(ChAdjacency* adjacency, uint32_t node)
+{
+    // returns the edge to (or from) node in an adjacency list of the builder or NULL
+    for (uint32_t i = 0; i<adjacency->size; ++i) {
+        if (adjacency->edges[i].node==node) return &adjacency->edges[i];
+    }
+    return NULL;
+}
+
+static void append_edge(ChAdjacency* adjacency, uint32_t node, float weight, uint32_t middle)
+{
+    if (adjacency->size==adjacency->capacity) {
+        adjacency->capacity = adjacency->capacity ? 2*adjacency->capacity : 4;
+        if ((adjacency->edges = realloc(adjacency->edges, adjacency->capacity*sizeof(ChEdge)))==NULL) exit(1);
+    }
+    adjacency->edges[adjacency->size].node = node;
+    adjacency->edges[adjacency->size].weight = weight;
+    adjacency->edges[adjacency->size].middle = middle;
+    adjacency->size++;
+}
+
+static void remove_edge(ChAdjacency* adjacency, uint32_t node)
+{
+    // removes the edge to (or from) node by moving the last edge into its place
+    ChEdge* edge = find_edge(adjacency, node);
+
+    if (edge==NULL) return;
+    adjacency->size--;
+    *edge = adjacency->edges[adjacency->size];
+}
+
+static void add_or_update_edge(ChBuilder* builder, uint32_t tail, uint32_t head, float weight, uint32_t middle)
+{
+    // adds the edge tail->head to the remaining graph or makes an existing one shorter
+    // parallel edges are never stored, only the shortest one
+    ChEdge* edge = find_edge(&builder->out[tail], head);
+
+    if (edge==NULL) {
+        append_edge(&builder->out[tail], head, weight, middle);
+        append_edge(&builder->in[head], tail, weight, middle);
+    }
+    else if (edge->weight>weight) {
+        edge->weight = weight;
+        edge->middle = middle;
+        edge = find_edge(&builder->in[head], tail);
+        edge->weight = weight;
+        edge->middle = middle;
+    }
+}
+
+static void witness_search(ChBuilder* builder, uint32_t source, uint32_t avoid, double max_distance,
+        unsigned long nr_of_targets)
+{
+    // dijkstra from source in the remaining graph without the node avoid
+    // it stops when all nodes marked with the current target stamp are settled, at max_distance (the longest
+    // possible shortcut) or after CH_WITNESS_LIMIT settled nodes, and follows paths of at most CH_WITNESS_HOPS
+    // edges, so a witness may be missed, which only costs an unnecessary shortcut
+    // the distances are in the status list of the witness workspace
+
+    SearchWorkspace* workspace = &builder->witness;
+    AStarStatus* current;
+    AStarStatus* successor;
+    ChAdjacency* out;
+    unsigned long current_index;
+    unsigned long nr_of_settled_nodes = 0;
+    float successor_current_cost;
+
+    if (nr_of_targets==0) return;
+    reset_workspace(workspace);
+    current = get_status(workspace, source);
+    current->g = 0;
+    current->whq = OPEN;
+    builder->hops[source] = 0;
+    queue_push(&workspace->open_queue, source, 0);
+
+    while (!queue_is_empty(&workspace->open_queue)) {
+        current_index = queue_pop(&workspace->open_queue);
+        current = &workspace->status_list[current_index];
+        current->whq = CLOSED;
+        if (current->g>max_distance || ++nr_of_settled_nodes>CH_WITNESS_LIMIT) break;
+        if (builder->target_stamp[current_index]==builder->current_stamp && --nr_of_targets==0) break;
+        if (builder->hops[current_index]==CH_WITNESS_HOPS) continue;
+
+        out = &builder->out[current_index];
+        for (uint32_t i = 0; i<out->size; ++i) {
+            if (out->edges[i].node==avoid) continue;
+            successor = get_status(workspace, out->edges[i].node);
+            successor_current_cost = current->g+out->edges[i].weight;
+            if (successor_current_cost>max_distance) continue;
+            if (successor->whq==NONE) {
+                successor->g = successor_current_cost;
+                successor->whq = OPEN;
+                builder->hops[out->edges[i].node] = builder->hops[current_index]+1;
+                queue_push(&workspace->open_queue, out->edges[i].node, successor_current_cost);
+            }
+            else if (successor->whq==OPEN && successor->g>successor_current_cost) {
+                successor->g = successor_current_cost;
+                builder->hops[out->edges[i].node] = builder->hops[current_index]+1;
+                queue_decrease_key(&workspace->open_queue, out->edges[i].node, successor_current_cost);
+            }
+        }
+    }
+}
+
+static unsigned long find_shortcuts(ChBuilder* builder, uint32_t node)
+{
+    // finds the shortcuts needed to remove node from the remaining graph and keeps them in the builder until
+    // the next call, so a node contracted right after its priority was computed needs no witness searches again
+    // a shortcut u->x is needed for the path u->node->x unless a witness path u->x avoiding node
+    // is at most as long
+    // returns the number of shortcuts which are new edges, the others only make an edge u->x shorter
+
+    ChAdjacency* in = &builder->in[node];
+    ChAdjacency* out = &builder->out[node];
+    unsigned long nr_of_new_edges = 0;
+    unsigned long nr_of_targets;
+    double max_out_weight;
+    double shortcut_weight;
+    uint32_t tail, head;
+
+    builder->nr_of_shortcuts = 0;
+    for (uint32_t i = 0; i<in->size; ++i) {
+        tail = in->edges[i].node;
+        // the heads of the possible shortcuts are the targets of the witness search
+        // and the longest shortcut from tail bounds its distance
+        nr_of_targets = 0;
+        max_out_weight = 0;
+        if (++builder->current_stamp==0) {
+            memset(builder->target_stamp, 0, builder->nr_of_nodes*sizeof(unsigned int));
+            builder->current_stamp = 1;
+        }
+        for (uint32_t j = 0; j<out->size; ++j) {
+            if (out->edges[j].node!=tail) {
+                builder->target_stamp[out->edges[j].node] = builder->current_stamp;
+                nr_of_targets++;
+                if (out->edges[j].weight>max_out_weight) max_out_weight = out->edges[j].weight;
+            }
+        }
+        witness_search(builder, tail, node, in->edges[i].weight+max_out_weight, nr_of_targets);
+        for (uint32_t j = 0; j<out->size; ++j) {
+            head = out->edges[j].node;
+            if (head==tail) continue;
+            shortcut_weight = (double) in->edges[i].weight+out->edges[j].weight;
+            if (is_reached(&builder->witness, head) && builder->witness.status_list[head].g<=shortcut_weight) continue;
+            if (builder->nr_of_shortcuts==builder->shortcut_capacity) {
+                builder->shortcut_capacity *= 2;
+                builder->shortcuts = realloc(builder->shortcuts, builder->shortcut_capacity*sizeof(ChShortcut));
+                if (builder->shortcuts==NULL) exit(1);
+            }
+            builder->shortcuts[builder->nr_of_shortcuts++] = (ChShortcut) {tail, head, (float) shortcut_weight};
+            if (find_edge(&builder->out[tail], head)==NULL) nr_of_new_edges++;
+        }
+    }
+    return nr_of_new_edges;
+}
+
+static double node_priority(ChBuilder* builder, uint32_t node)
+{
+    // edge difference (edges added minus edges removed) plus the number of contracted neighbours and the
+    // depth of the node, the latter two spread the contraction evenly over the graph and keep the hierarchy flat,
+    // which keeps the search spaces of the queries small
+    // the shortcuts of the node are left in the builder, see find_shortcuts
+    double edge_difference = (double) find_shortcuts(builder, node)-builder->in[node].size-builder->out[node].size;
+    return CH_EDGE_DIFFERENCE_WEIGHT*edge_difference+builder->deleted_neighbours[node]+builder->depth[node];
+}
+
+static void contracted_neighbour(ChBuilder* builder, uint32_t node, uint32_t neighbour)
+{
+    // a neighbour of the contracted node has one more contracted neighbour and lies above node in the hierarchy
+    builder->deleted_neighbours[neighbour]++;
+    if (builder->depth[neighbour]<builder->depth[node]+1) builder->depth[neighbour] = builder->depth[node]+1;
+}
+
+static void write_hierarchy_arrays(ChBuilder* builder, ContractionHierarchy* hierarchy)
+{
+    // after the contraction the edges left at every node lead to nodes contracted later, i.e. upwards
+    // they are packed into the CSR arrays of the hierarchy
+
+    unsigned long n = hierarchy->nr_of_nodes;
+
+    hierarchy->up_offsets = malloc((n+1)*sizeof(uint32_t));
+    hierarchy->down_offsets = malloc((n+1)*sizeof(uint32_t));
+    if (hierarchy->up_offsets==NULL || hierarchy->down_offsets==NULL) exit(1);
+    hierarchy->up_offsets[0] = hierarchy->down_offsets[0] = 0;
+    for (unsigned long i = 0; i<n; ++i) {
+        hierarchy->up_offsets[i+1] = hierarchy->up_offsets[i]+builder->out[i].size;
+        hierarchy->down_offsets[i+1] = hierarchy->down_offsets[i]+builder->in[i].size;
+    }
+    hierarchy->nr_of_up_edges = hierarchy->up_offsets[n];
+    hierarchy->nr_of_down_edges = hierarchy->down_offsets[n];
+    hierarchy->up_edges = malloc(hierarchy->nr_of_up_edges*sizeof(ChEdge));
+    hierarchy->down_edges = malloc(hierarchy->nr_of_down_edges*sizeof(ChEdge));
+    if (hierarchy->up_edges==NULL || hierarchy->down_edges==NULL) exit(1);
+    for (unsigned long i = 0; i<n; ++i) {
+        memcpy(hierarchy->up_edges+hierarchy->up_offsets[i], builder->out[i].edges, builder->out[i].size*sizeof(ChEdge));
+        memcpy(hierarchy->down_edges+hierarchy->down_offsets[i], builder->in[i].edges,
+                builder->in[i].size*sizeof(ChEdge));
+    }
+}
+
+unsigned long build_contraction_hierarchy(Graph* graph, ContractionHierarchy* hierarchy)
+{
+    // contracts all nodes of the graph, always the one with the lowest priority next
+    // the priorities are updated lazily: the popped node gets its priority recomputed and is pushed
+    // back if it is not the lowest any more, otherwise it is contracted with the shortcuts just found
+    // returns the number of shortcuts in the hierarchy
+
+    unsigned long n = graph->nr_of_nodes;
+    ChBuilder builder;
+    PriorityQueue order_queue;
+    double priority;
+    uint32_t node;
+    uint32_t rank = 0;
+    unsigned long nr_of_shortcuts = 0;
+    ChShortcut* shortcut;
+
+    memset(hierarchy, 0, sizeof(ContractionHierarchy));
+    hierarchy->nr_of_nodes = n;
+    hierarchy->rank = malloc(n*sizeof(uint32_t));
+    builder.out = calloc(n, sizeof(ChAdjacency));
+    builder.in = calloc(n, sizeof(ChAdjacency));
+    builder.deleted_neighbours = calloc(n, sizeof(unsigned int));
+    builder.depth = calloc(n, sizeof(unsigned int));
+    builder.hops = malloc(n*sizeof(uint8_t));
+    builder.target_stamp = calloc(n, sizeof(unsigned int));
+    builder.current_stamp = 0;
+    builder.nr_of_nodes = n;
+    builder.shortcut_capacity = 64;
+    builder.shortcuts = malloc(builder.shortcut_capacity*sizeof(ChShortcut));
+    if (hierarchy->rank==NULL || builder.out==NULL || builder.in==NULL || builder.deleted_neighbours==NULL ||
+            builder.depth==NULL || builder.hops==NULL || builder.target_stamp==NULL || builder.shortcuts==NULL)
+        exit(1);
+    init_workspace(&builder.witness, n, DARY_HEAP);
+    queue_init(&order_queue, DARY_HEAP, n);
+
+    for (unsigned long tail = 0; tail<n; ++tail) {
+        for (uint32_t i = graph->offsets[tail]; i<graph->offsets[tail+1]; ++i) {
+            if (graph->targets[i]!=tail) {
+                add_or_update_edge(&builder, (uint32_t) tail, graph->targets[i], graph->weights[i], CH_NO_MIDDLE);
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i<n; ++i) {
+        queue_push(&order_queue, i, node_priority(&builder, i));
+    }
+
+    while (!queue_is_empty(&order_queue)) {
+        node = (uint32_t) queue_pop(&order_queue);
+        priority = node_priority(&builder, node);
+        if (!queue_is_empty(&order_queue) && priority>queue_min_key(&order_queue)) {
+            queue_push(&order_queue, node, priority);
+            continue;
+        }
+
+        for (unsigned long i = 0; i<builder.nr_of_shortcuts; ++i) {
+            shortcut = &builder.shortcuts[i];
+            add_or_update_edge(&builder, shortcut->tail, shortcut->head, shortcut->weight, node);
+        }
+        hierarchy->rank[node] = rank++;
+
+        // the node leaves the remaining graph, only its own lists keep the edges (they all go upwards)
+        for (uint32_t i = 0; i<builder.in[node].size; ++i) {
+            remove_edge(&builder.out[builder.in[node].edges[i].node], node);
+            contracted_neighbour(&builder, node, builder.in[node].edges[i].node);
+        }
+        for (uint32_t i = 0; i<builder.out[node].size; ++i) {
+            remove_edge(&builder.in[builder.out[node].edges[i].node], node);
+            contracted_neighbour(&builder, node, builder.out[node].edges[i].node);
+        }
+    }
+
+    write_hierarchy_arrays(&builder, hierarchy);
+    for (unsigned long i = 0; i<hierarchy->nr_of_up_edges; ++i) {
+        if (hierarchy->up_edges[i].middle!=CH_NO_MIDDLE) nr_of_shortcuts++;
+    }
+    for (unsigned long i = 0; i<hierarchy->nr_of_down_edges; ++i) {
+        if (hierarchy->down_edges[i].middle!=CH_NO_MIDDLE) nr_of_shortcuts++;
+    }
+
+    for (unsigned long i = 0; i<n; ++i) {
+        free(builder.out[i].edges);
+        free(builder.in[i].edges);
+    }
+    free(builder.out);
+    free(builder.in);
+    free(builder.deleted_neighbours);
+    free(builder.depth);
+    free(builder.hops);
+    free(builder.target_stamp);
+    free(builder.shortcuts);
+    free_workspace(&builder.witness);
+    queue_free(&order_queue);
+    return nr_of_shortcuts;
+}
+
+int write_hierarchy_file(const char* filename, Graph* graph, ContractionHierarchy* hierarchy)
+{
+    // writes the hierarchy in the page aligned layout of the graph file, so it can be mapped as well
+    // returns 0, ASTAR_OPEN_ERROR or ASTAR_WRITE_ERROR
+
+    FILE* fout;
+    ChFileHeader header;
+    int code;
+    unsigned long n = hierarchy->nr_of_nodes;
+    void* data[CH_SECTIONS] = {hierarchy->rank, hierarchy->up_offsets, hierarchy->up_edges, hierarchy->down_offsets,
+                               hierarchy->down_edges};
+    uint64_t size[CH_SECTIONS] = {n*sizeof(uint32_t), (n+1)*sizeof(uint32_t),
+                                  hierarchy->nr_of_up_edges*sizeof(ChEdge), (n+1)*sizeof(uint32_t),
+                                  hierarchy->nr_of_down_edges*sizeof(ChEdge)};
+
+    memset(&header, 0, sizeof(ChFileHeader));
+    memcpy(header.magic, CH_MAGIC, sizeof(header.magic));
+    header.version = GRAPH_VERSION;
+    header.endianness = GRAPH_ENDIANNESS;
+    header.nr_of_nodes = graph->nr_of_nodes;
+    header.nr_of_edges = graph->nr_of_edges;
+    header.fingerprint = graph->fingerprint;
+    header.nr_of_up_edges = hierarchy->nr_of_up_edges;
+    header.nr_of_down_edges = hierarchy->nr_of_down_edges;
+
+    if ((fout = fopen(filename, "wb"))==NULL) return ASTAR_OPEN_ERROR;
+    code = write_sections(fout, &header, sizeof(ChFileHeader), header.sections, data, size, CH_SECTIONS);
+    if (fclose(fout)!=0 && code==0) code = ASTAR_WRITE_ERROR;
+    return code;
+}
+
+int read_hierarchy_file(const char* filename, Graph* graph, ContractionHierarchy* hierarchy)
+{
+    // maps a hierarchy file written by write_hierarchy_file for the given graph
+    // returns 0 or the code of map_file, a file of another graph (size or fingerprint) or version and a file whose
+    // sections do not fit are rejected with ASTAR_READ_ERROR and leave nothing mapped
+
+    ChFileHeader* header;
+    unsigned long n = graph->nr_of_nodes;
+    bool valid = true;
+    int code;
+
+    memset(hierarchy, 0, sizeof(ContractionHierarchy));
+    code = map_file(filename, sizeof(ChFileHeader), &hierarchy->mapping, &hierarchy->mapping_size);
+    if (code!=0) return code;
+    header = hierarchy->mapping;
+    if (memcmp(header->magic, CH_MAGIC, sizeof(header->magic))!=0 || header->version!=GRAPH_VERSION ||
+            header->endianness!=GRAPH_ENDIANNESS || header->nr_of_nodes!=graph->nr_of_nodes ||
+            header->nr_of_edges!=graph->nr_of_edges || header->fingerprint!=graph->fingerprint) {
+        free_hierarchy(hierarchy);
+        return ASTAR_READ_ERROR;
+    }
+
+    hierarchy->nr_of_nodes = n;
+    hierarchy->nr_of_up_edges = header->nr_of_up_edges;
+    hierarchy->nr_of_down_edges = header->nr_of_down_edges;
+    hierarchy->rank = map_section(header, hierarchy->mapping_size, &header->sections[0], n*sizeof(uint32_t), &valid);
+    hierarchy->up_offsets = map_section(header, hierarchy->mapping_size, &header->sections[1],
+            (n+1)*sizeof(uint32_t), &valid);
+    hierarchy->up_edges = map_section(header, hierarchy->mapping_size, &header->sections[2],
+            hierarchy->nr_of_up_edges*sizeof(ChEdge), &valid);
+    hierarchy->down_offsets = map_section(header, hierarchy->mapping_size, &header->sections[3],
+            (n+1)*sizeof(uint32_t), &valid);
+    hierarchy->down_edges = map_section(header, hierarchy->mapping_size, &header->sections[4],
+            hierarchy->nr_of_down_edges*sizeof(ChEdge), &valid);
+    if (!valid) {
+        free_hierarchy(hierarchy);
+        return ASTAR_READ_ERROR;
+    }
+    return 0;
+}
+
+void free_hierarchy(ContractionHierarchy* hierarchy)
+{
+    if (hierarchy->mapping!=NULL) {
+        munmap(hierarchy->mapping, hierarchy->mapping_size);
+    }
+    else {
+        free(hierarchy->rank);
+        free(hierarchy->up_offsets);
+        free(hierarchy->up_edges);
+        free(hierarchy->down_offsets);
+        free(hierarchy->down_edges);
+    }
+    memset(hierarchy, 0, sizeof(ContractionHierarchy));
+}
+
+static ChEdge* find_hierarchy_edge(ContractionHierarchy* hierarchy, uint32_t tail, uint32_t head)
+{
+    // returns the shortest edge tail->head of the hierarchy or NULL if a damaged .ch does not have it
+    // it is stored at the lower ranked node: in the upward edges of tail or the downward edges of head
+    uint32_t* offsets = hierarchy->up_offsets;
+    ChEdge* edges = hierarchy->up_edges;
+    uint32_t from = tail, to = head;
+    ChEdge* shortest = NULL;
+
+    if (hierarchy->rank[tail]>hierarchy->rank[head]) {
+        offsets = hierarchy->down_offsets;
+        edges = hierarchy->down_edges;
+        from = head;
+        to = tail;
+    }
+    for (uint32_t i = offsets[from]; i<offsets[from+1]; ++i) {
+        if (edges[i].node==to && (shortest==NULL || edges[i].weight<shortest->weight)) shortest = &edges[i];
+    }
+    return shortest;
+}
+
+static bool unpack_edge(ContractionHierarchy* hierarchy, uint32_t tail, uint32_t head, Path* path, double* distance)
+{
+    // appends the original nodes of the edge tail->head (without tail) to the path
+    // a shortcut is replaced by its two halves through the middle node, recursively
+    // returns false if an edge of the hierarchy is missing or a middle node was not contracted before both ends,
+    // which also ends the recursion on a damaged .ch
+    ChEdge* edge = find_hierarchy_edge(hierarchy, tail, head);
+
+    if (edge==NULL) return false;
+    if (edge->middle==CH_NO_MIDDLE) {
+        *distance += edge->weight;
+        append_to_path(path, head, *distance);
+        return true;
+    }
+    if (edge->middle>=hierarchy->nr_of_nodes || hierarchy->rank[edge->middle]>=hierarchy->rank[tail] ||
+            hierarchy->rank[edge->middle]>=hierarchy->rank[head])
+        return false;
+    return unpack_edge(hierarchy, tail, edge->middle, path, distance) &&
+            unpack_edge(hierarchy, edge->middle, head, path, distance);
+}
+
+int hierarchy_search(unsigned long start_index, unsigned long goal_index, Graph* graph, SearchWorkspace* forward,
+        SearchWorkspace* backward, Arena* scratch, Path* path)
+{
+    // bidirectional dijkstra on the hierarchy in graph->hierarchy
+    // the forward search follows the upward edges from the start, the backward search the downward edges
+    // (backwards, i.e. also upwards) from the goal
+    // a direction stops once its smallest distance reaches the best path through a node settled by both
+    // nodes which are reached shorter from a higher node are stalled, i.e. not relaxed
+    // returns 0 if a path is found, it is then written to path with all shortcuts unpacked, otherwise
+    // ASTAR_NO_ROUTE or ASTAR_READ_ERROR if a shortcut can not be unpacked (a damaged .ch)
+    // the hierarchy path is kept in the scratch arena of the query until then
+
+    ContractionHierarchy* hierarchy = graph->hierarchy;
+    SearchWorkspace* workspaces[2] = {forward, backward};
+    SearchWorkspace* workspace;
+    SearchWorkspace* other;
+    uint32_t* edge_offsets[2] = {hierarchy->up_offsets, hierarchy->down_offsets};
+    ChEdge* edges[2] = {hierarchy->up_edges, hierarchy->down_edges};
+    double best_length = DBL_MAX;
+    unsigned long meeting_index = ULONG_MAX;
+    int direction = 0;
+
+    AStarStatus* current;
+    AStarStatus* successor;
+    ChEdge* edge;
+    unsigned long current_index;
+    unsigned long* hierarchy_nodes;
+    unsigned long nr_of_hierarchy_nodes;
+    unsigned long nr_of_forward = 0;
+    unsigned long position;
+    unsigned long index;
+    float successor_current_cost;
+    double distance = 0;
+    bool stalled;
+
+    reset_workspace(forward);
+    reset_workspace(backward);
+    for (int i = 0; i<2; ++i) {
+        current_index = i==0 ? start_index : goal_index;
+        current = get_status(workspaces[i], current_index);
+        current->g = 0;
+        current->parent = NO_PARENT;
+        current->whq = OPEN;
+        queue_push(&workspaces[i]->open_queue, current_index, 0);
+    }
+
+    while (!queue_is_empty(&forward->open_queue) || !queue_is_empty(&backward->open_queue)) {
+        if (queue_is_empty(&workspaces[direction]->open_queue)) direction = 1-direction;
+        workspace = workspaces[direction];
+        other = workspaces[1-direction];
+
+        current_index = queue_pop(&workspace->open_queue);
+        current = &workspace->status_list[current_index];
+        if (current->g>=best_length) {
+            // nothing shorter can come from this direction any more
+            queue_clear(&workspace->open_queue);
+            continue;
+        }
+        current->whq = CLOSED;
+        workspace->stats.settled_nodes++;
+
+        if (is_reached(other, current_index) &&
+                current->g+other->status_list[current_index].g<best_length) {
+            best_length = current->g+other->status_list[current_index].g;
+            meeting_index = current_index;
+        }
+
+        // stall on demand: if a higher node reaches this one shorter through an edge of the other direction,
+        // this distance is not the shortest and nothing has to be relaxed from here
+        stalled = false;
+        for (uint32_t i = edge_offsets[1-direction][current_index];
+                i<edge_offsets[1-direction][current_index+1] && !stalled; ++i) {
+            edge = &edges[1-direction][i];
+            stalled = is_reached(workspace, edge->node) &&
+                    workspace->status_list[edge->node].g+edge->weight<current->g;
+        }
+        if (stalled) {
+            direction = 1-direction;
+            continue;
+        }
+
+        workspace->stats.relaxed_edges +=
+                edge_offsets[direction][current_index+1]-edge_offsets[direction][current_index];
+        for (uint32_t i = edge_offsets[direction][current_index]; i<edge_offsets[direction][current_index+1]; ++i) {
+            edge = &edges[direction][i];
+            successor = get_status(workspace, edge->node);
+            successor_current_cost = current->g+edge->weight;
+            if (successor->whq==NONE) {
+                successor->g = successor_current_cost;
+                successor->parent = current_index;
+                successor->whq = OPEN;
+                queue_push(&workspace->open_queue, edge->node, successor_current_cost);
+            }
+            else if (successor->whq==OPEN && successor->g>successor_current_cost) {
+                successor->g = successor_current_cost;
+                successor->parent = current_index;
+                queue_decrease_key(&workspace->open_queue, edge->node, successor_current_cost);
+            }
+        }
+        direction = 1-direction;
+    }
+
+    if (meeting_index==ULONG_MAX) return ASTAR_NO_ROUTE;
+
+    // the nodes of the hierarchy path: start .. meeting node from the forward parents (reversed),
+    // then up to the goal from the backward parents
+    for (index = meeting_index; index!=NO_PARENT; index = forward->status_list[index].parent) nr_of_forward++;
+    nr_of_hierarchy_nodes = nr_of_forward;
+    for (index = backward->status_list[meeting_index].parent; index!=NO_PARENT;
+            index = backward->status_list[index].parent)
+        nr_of_hierarchy_nodes++;
+    hierarchy_nodes = arena_alloc(scratch, nr_of_hierarchy_nodes*sizeof(unsigned long));
+    position = nr_of_forward;
+    for (index = meeting_index; index!=NO_PARENT; index = forward->status_list[index].parent) {
+        hierarchy_nodes[--position] = index;
+    }
+    position = nr_of_forward;
+    for (index = backward->status_list[meeting_index].parent; index!=NO_PARENT;
+            index = backward->status_list[index].parent) {
+        hierarchy_nodes[position++] = index;
+    }
+
+    path->nr_of_nodes = 0;
+    append_to_path(path, start_index, 0);
+    for (unsigned long i = 1; i<nr_of_hierarchy_nodes; ++i) {
+        if (!unpack_edge(hierarchy, (uint32_t) hierarchy_nodes[i-1], (uint32_t) hierarchy_nodes[i], path, &distance)) {
+            path->nr_of_nodes = 0;
+            return ASTAR_READ_ERROR;
+        }
+    }
+    path->length = best_length;
+    return 0;
+}
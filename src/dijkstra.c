@@ -0,0 +1,148 @@
+// dijkstra.c
+// one-to-all searches without a goal, used for preprocessing and reachability,
+// and one-to-many searches for distance matrices
+
+
+#include "astar.h"
+
+static unsigned long settle_nodes(unsigned long source_index, Graph* graph, SearchWorkspace* workspace, bool backward,
+        double max_distance, uint32_t* settled_indices, uint32_t* target_columns, unsigned long nr_of_targets,
+        double* distances)
+{
+    // the search of dijkstra and dijkstra_to_targets, it stops when nothing within max_distance is left or,
+    // with target_columns, as soon as all nr_of_targets targets are settled
+    // returns the number of settled nodes
+
+    PriorityQueue* open_queue = &workspace->open_queue;
+    AStarStatus* status_list = workspace->status_list;
+    AStarStatus* current;
+    AStarStatus* successor;
+    unsigned long current_index;
+    unsigned long node_successor_index;
+    unsigned long nr_of_settled_nodes = 0;
+    unsigned long nr_of_open_targets = nr_of_targets;
+    float successor_current_cost;
+    uint32_t* edge_offsets = backward ? graph->reverse_offsets : graph->offsets;
+    uint32_t* edge_heads = backward ? graph->sources : graph->targets;
+    float* edge_weights = backward ? graph->reverse_weights : graph->weights;
+
+    reset_workspace(workspace);
+
+    current = get_status(workspace, source_index);
+    current->g = 0;
+    current->parent = NO_PARENT;
+    current->whq = OPEN;
+    queue_push(open_queue, source_index, 0);
+
+    while (!queue_is_empty(open_queue)) {
+        current_index = queue_pop(open_queue);
+        current = &status_list[current_index];
+        current->whq = CLOSED;
+        if (settled_indices!=NULL) settled_indices[nr_of_settled_nodes] = (uint32_t) current_index;
+        nr_of_settled_nodes++;
+        workspace->stats.settled_nodes++;
+        if (target_columns!=NULL && target_columns[current_index]!=UINT32_MAX) {
+            distances[target_columns[current_index]] = current->g;
+            if (--nr_of_open_targets==0) break;
+        }
+        workspace->stats.relaxed_edges += edge_offsets[current_index+1]-edge_offsets[current_index];
+
+        for (uint32_t i = edge_offsets[current_index]; i<edge_offsets[current_index+1]; ++i) {
+            node_successor_index = edge_heads[i];
+            successor_current_cost = current->g+edge_weights[i];
+            // nodes beyond the limit are never put into the queue, so they are not reached
+            if (successor_current_cost>max_distance) continue;
+            successor = get_status(workspace, node_successor_index);
+            if (successor->whq==NONE) {
+                successor->g = successor_current_cost;
+                successor->parent = current_index;
+                successor->whq = OPEN;
+                queue_push(open_queue, node_successor_index, successor_current_cost);
+            }
+            else if (successor->whq==OPEN && successor->g>successor_current_cost) {
+                successor->g = successor_current_cost;
+                successor->parent = current_index;
+                queue_decrease_key(open_queue, node_successor_index, successor_current_cost);
+            }
+        }
+    }
+    return nr_of_settled_nodes;
+}
+
+unsigned long dijkstra(unsigned long source_index, Graph* graph, SearchWorkspace* workspace, bool backward,
+        double max_distance, uint32_t* settled_indices)
+{
+    // settles all nodes with a distance of at most max_distance from the source
+    // (to the source on the reverse graph if backward is true)
+    // afterwards a node is reached iff is_reached(workspace, index) and its distance is the g of its status
+    // the parents give the shortest path tree
+    // if settled_indices is not NULL (room for all nodes) the settled nodes are written to it by ascending distance,
+    // so the reached set is known without looking at every node
+    // returns the number of settled nodes
+
+    return settle_nodes(source_index, graph, workspace, backward, max_distance, settled_indices, NULL, 0, NULL);
+}
+
+unsigned long dijkstra_to_targets(unsigned long source_index, Graph* graph, SearchWorkspace* workspace,
+        uint32_t* target_columns, unsigned long nr_of_targets, double* distances)
+{
+    // settles nodes from the source until all nr_of_targets targets are settled or nothing is left
+    // target_columns has the column of every target node and UINT32_MAX for the other nodes,
+    // the distance of a target goes into distances[column], the ones of unreachable targets are not touched
+    // returns the number of settled nodes
+
+    if (nr_of_targets==0) return 0;
+    return settle_nodes(source_index, graph, workspace, false, DBL_MAX, NULL, target_columns, nr_of_targets,
+            distances);
+}
+
+static void* matrix_worker(void* argument)
+{
+    // takes the next source of the matrix until all rows are computed, with a workspace of its own
+
+    MatrixContext* matrix = argument;
+    SearchWorkspace workspace;
+    unsigned long source;
+    double* row;
+
+    init_workspace(&workspace, matrix->graph->nr_of_nodes, matrix->queue_type);
+    while ((source = __sync_fetch_and_add(&matrix->next_source, 1))<matrix->nr_of_sources) {
+        row = matrix->distances+source*matrix->nr_of_targets;
+        for (unsigned long j = 0; j<matrix->nr_of_targets; ++j) row[j] = -1;
+        dijkstra_to_targets(matrix->sources[source], matrix->graph, &workspace, matrix->target_columns,
+                matrix->nr_of_distinct_targets, row);
+        // a target given more than once gets the distance of its first column
+        for (unsigned long j = 0; j<matrix->nr_of_targets; ++j) row[j] = row[matrix->first_columns[j]];
+    }
+    free_workspace(&workspace);
+    return NULL;
+}
+
+void distance_matrix(Graph* graph, QueueType queue_type, uint32_t* sources, unsigned long nr_of_sources,
+        uint32_t* targets, unsigned long nr_of_targets, unsigned int nr_of_threads, double* distances)
+{
+    // computes the distances from every source to every target (node indices) with one Dijkstra search per source
+    // which stops as soon as all targets are settled, the sources are shared by nr_of_threads threads
+    // distances is row-major, one row of nr_of_targets per source, -1 for a target which can not be reached
+
+    MatrixContext matrix = {.graph=graph, .queue_type=queue_type, .sources=sources, .nr_of_sources=nr_of_sources,
+                            .nr_of_targets=nr_of_targets, .nr_of_distinct_targets=0, .distances=distances,
+                            .next_source=0};
+
+    matrix.target_columns = malloc(graph->nr_of_nodes*sizeof(uint32_t));
+    matrix.first_columns = malloc(nr_of_targets*sizeof(uint32_t));
+    if (matrix.target_columns==NULL || (matrix.first_columns==NULL && nr_of_targets>0)) exit(1);
+    memset(matrix.target_columns, 0xff, graph->nr_of_nodes*sizeof(uint32_t));
+    for (unsigned long j = 0; j<nr_of_targets; ++j) {
+        if (matrix.target_columns[targets[j]]==UINT32_MAX) {
+            matrix.target_columns[targets[j]] = (uint32_t) j;
+            matrix.nr_of_distinct_targets++;
+        }
+        matrix.first_columns[j] = matrix.target_columns[targets[j]];
+    }
+
+    if (nr_of_threads>nr_of_sources) nr_of_threads = nr_of_sources>0 ? (unsigned int) nr_of_sources : 1;
+    run_parallel(nr_of_threads, matrix_worker, &matrix);
+    free(matrix.first_columns);
+    free(matrix.target_columns);
+}
@@ -0,0 +1,159 @@
+// distance.c
+// vectorized air distance kernels for the heuristic and the edge weights
+// the nodes are unit vectors on the sphere, the great circle distance follows from the chord between two of them
+// without any trigonometric call, so several distances can be computed at once with SSE2 or AVX2
+
+
+#include "astar.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// asin(s) = s*(1+s^2/6+3s^4/40+5s^6/112+...), all terms are positive so the truncated series never
+// overestimates, the first left out term is below 1e-9 of the distance up to 1500 km
+#define ASIN_C3 (1.0/6.0)
+#define ASIN_C5 (3.0/40.0)
+#define ASIN_C7 (5.0/112.0)
+
+void build_unit_vectors(Graph* graph)
+{
+    // computes the unit vector of every node from its coordinates
+    // x points to latitude 0 longitude 0, y to latitude 0 longitude 90 and z to the north pole
+
+    unsigned long n = graph->nr_of_nodes;
+    double lat, lon;
+
+    graph->unit_x = malloc(n*sizeof(double));
+    graph->unit_y = malloc(n*sizeof(double));
+    graph->unit_z = malloc(n*sizeof(double));
+    if (graph->unit_x==NULL || graph->unit_y==NULL || graph->unit_z==NULL) exit(1);
+    for (unsigned long i = 0; i<n; ++i) {
+        lat = node_lat(graph, i)*M_PI/180.0;
+        lon = node_lon(graph, i)*M_PI/180.0;
+        graph->unit_x[i] = cos(lat)*cos(lon);
+        graph->unit_y[i] = cos(lat)*sin(lon);
+        graph->unit_z[i] = sin(lat);
+    }
+}
+
+static inline double chord_to_distance(double chord_squared)
+{
+    // great circle distance for the squared chord between two unit vectors: 2*R*asin(chord/2)
+    double s_squared = chord_squared*0.25;
+    double s = sqrt(s_squared);
+
+    return 2*R*s*(1+s_squared*(ASIN_C3+s_squared*(ASIN_C5+s_squared*ASIN_C7)));
+}
+
+double chord_distance(unsigned long node_a_index, unsigned long node_b_index, Graph* graph)
+{
+    // returns the same distance as haversine_distance (the haversine a is the squared half chord)
+    // up to the rounding, but from the unit vectors of the nodes
+
+    double dx = graph->unit_x[node_a_index]-graph->unit_x[node_b_index];
+    double dy = graph->unit_y[node_a_index]-graph->unit_y[node_b_index];
+    double dz = graph->unit_z[node_a_index]-graph->unit_z[node_b_index];
+
+    return chord_to_distance(dx*dx+dy*dy+dz*dz);
+}
+
+void chord_distances_scalar(Graph* graph, const uint32_t* indices, unsigned long count, unsigned long target_index,
+        double* distances)
+{
+    // distances[i] is the chord_distance from node indices[i] to node target_index, one at a time
+    for (unsigned long i = 0; i<count; ++i) {
+        distances[i] = chord_distance(indices[i], target_index, graph);
+    }
+}
+
+#if defined(__x86_64__)
+void chord_distances_sse2(Graph* graph, const uint32_t* indices, unsigned long count, unsigned long target_index,
+        double* distances)
+{
+    // the same two at a time, SSE2 is part of every x86-64 processor
+    // SSE2 has no gather, the coordinates of the two nodes are loaded one by one
+
+    __m128d tx = _mm_set1_pd(graph->unit_x[target_index]);
+    __m128d ty = _mm_set1_pd(graph->unit_y[target_index]);
+    __m128d tz = _mm_set1_pd(graph->unit_z[target_index]);
+    __m128d dx, dy, dz, s_squared, s, poly;
+    unsigned long i = 0;
+
+    for (; i+2<=count; i += 2) {
+        dx = _mm_sub_pd(_mm_set_pd(graph->unit_x[indices[i+1]], graph->unit_x[indices[i]]), tx);
+        dy = _mm_sub_pd(_mm_set_pd(graph->unit_y[indices[i+1]], graph->unit_y[indices[i]]), ty);
+        dz = _mm_sub_pd(_mm_set_pd(graph->unit_z[indices[i+1]], graph->unit_z[indices[i]]), tz);
+        s_squared = _mm_mul_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), _mm_mul_pd(dz, dz)),
+                _mm_set1_pd(0.25));
+        s = _mm_sqrt_pd(s_squared);
+        poly = _mm_add_pd(_mm_set1_pd(ASIN_C5), _mm_mul_pd(s_squared, _mm_set1_pd(ASIN_C7)));
+        poly = _mm_add_pd(_mm_set1_pd(ASIN_C3), _mm_mul_pd(s_squared, poly));
+        poly = _mm_add_pd(_mm_set1_pd(1.0), _mm_mul_pd(s_squared, poly));
+        _mm_storeu_pd(distances+i, _mm_mul_pd(_mm_mul_pd(s, poly), _mm_set1_pd(2.0*R)));
+    }
+    chord_distances_scalar(graph, indices+i, count-i, target_index, distances+i);
+}
+
+__attribute__((target("avx2,fma")))
+void chord_distances_avx2(Graph* graph, const uint32_t* indices, unsigned long count, unsigned long target_index,
+        double* distances)
+{
+    // the same four at a time
+    // the coordinates are loaded one by one as well, the gather instructions are slower than that on
+    // processors with the microcode fix for gather data sampling
+
+    __m256d tx = _mm256_set1_pd(graph->unit_x[target_index]);
+    __m256d ty = _mm256_set1_pd(graph->unit_y[target_index]);
+    __m256d tz = _mm256_set1_pd(graph->unit_z[target_index]);
+    __m256d dx, dy, dz, s_squared, s, poly;
+    const uint32_t* j;
+    unsigned long i = 0;
+
+    for (; i+4<=count; i += 4) {
+        j = indices+i;
+        dx = _mm256_sub_pd(_mm256_set_pd(graph->unit_x[j[3]], graph->unit_x[j[2]], graph->unit_x[j[1]],
+                graph->unit_x[j[0]]), tx);
+        dy = _mm256_sub_pd(_mm256_set_pd(graph->unit_y[j[3]], graph->unit_y[j[2]], graph->unit_y[j[1]],
+                graph->unit_y[j[0]]), ty);
+        dz = _mm256_sub_pd(_mm256_set_pd(graph->unit_z[j[3]], graph->unit_z[j[2]], graph->unit_z[j[1]],
+                graph->unit_z[j[0]]), tz);
+        s_squared = _mm256_fmadd_pd(dz, dz, _mm256_fmadd_pd(dy, dy, _mm256_mul_pd(dx, dx)));
+        s_squared = _mm256_mul_pd(s_squared, _mm256_set1_pd(0.25));
+        s = _mm256_sqrt_pd(s_squared);
+        poly = _mm256_fmadd_pd(s_squared, _mm256_set1_pd(ASIN_C7), _mm256_set1_pd(ASIN_C5));
+        poly = _mm256_fmadd_pd(s_squared, poly, _mm256_set1_pd(ASIN_C3));
+        poly = _mm256_fmadd_pd(s_squared, poly, _mm256_set1_pd(1.0));
+        _mm256_storeu_pd(distances+i, _mm256_mul_pd(_mm256_mul_pd(s, poly), _mm256_set1_pd(2.0*R)));
+    }
+    // the compiler leaves out the vzeroupper before the tail call, the SSE code after it would be slowed
+    // down by the dirty upper halves of the registers
+    _mm256_zeroupper();
+    chord_distances_scalar(graph, indices+i, count-i, target_index, distances+i);
+}
+#endif
+
+DistanceKernel distance_kernel(void)
+{
+    // returns the fastest kernel the processor supports, chosen at run time so one build runs everywhere
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return chord_distances_avx2;
+    return chord_distances_sse2;
+#else
+    return chord_distances_scalar;
+#endif
+}
+
+void heuristic_batch(const uint32_t* indices, unsigned long count, unsigned long goal_index, Graph* graph,
+        Heuristic distance_method, double* distances)
+{
+    // distances[i] is heuristic_distance(indices[i], goal_index), the haversine heuristic is vectorized,
+    // the other heuristics are evaluated one by one
+    if (distance_method==HAVERSINE) {
+        distance_kernel()(graph, indices, count, goal_index, distances);
+        return;
+    }
+    for (unsigned long i = 0; i<count; ++i) {
+        distances[i] = heuristic_distance(indices[i], goal_index, graph, distance_method);
+    }
+}
@@ -0,0 +1,492 @@
+// graph.c
+// derived structures of the graph which are built once and then only read
+
+
+#include "astar.h"
+
+
+static uint64_t mix(uint64_t hash, uint64_t value) {
+    // one step of the fingerprint, every bit of value changes about half of the bits of the hash
+    hash = (hash ^ value) * 0x9e3779b97f4a7c15ULL;
+    return hash ^ (hash >> 29);
+}
+
+uint64_t graph_fingerprint(Graph *graph) {
+    // hash of the ids in node order, the offsets, the edge heads and the edge lengths
+    // landmark and hierarchy files store the fingerprint of their graph and refer to its node indices,
+    // a graph converted again with another node order (-O) or other coordinates (-F) has the same counts
+    // but another fingerprint, so its old side files are rejected instead of giving wrong routes
+
+    uint64_t hash = mix(graph->nr_of_nodes, graph->nr_of_edges);
+    uint32_t weight;
+
+    for (unsigned long i = 0; i < graph->nr_of_nodes; ++i) hash = mix(hash, graph->ids[i]);
+    for (unsigned long i = 0; i <= graph->nr_of_nodes; ++i) hash = mix(hash, graph->offsets[i]);
+    for (unsigned long i = 0; i < graph->nr_of_edges; ++i) {
+        memcpy(&weight, &graph->weights[i], sizeof(uint32_t));
+        hash = mix(hash, (uint64_t) graph->targets[i] << 32 | weight);
+    }
+    return hash;
+}
+
+void build_reverse_graph(Graph *graph) {
+    // builds the reverse graph (predecessors with the edge lengths) from the successors
+    // counting sort over the edge heads, so the predecessors of each node keep the order of the edges
+
+    unsigned long n = graph->nr_of_nodes;
+    unsigned long m = graph->nr_of_edges;
+    uint32_t *next_position;
+
+    graph->reverse_offsets = calloc(n + 1, sizeof(uint32_t));
+    graph->sources = malloc(m * sizeof(uint32_t));
+    graph->reverse_weights = malloc(m * sizeof(float));
+    next_position = malloc((n + 1) * sizeof(uint32_t));
+    if (graph->reverse_offsets == NULL || graph->sources == NULL || graph->reverse_weights == NULL ||
+        next_position == NULL)
+        exit(1);
+
+    // reverse_offsets[i+1] counts the predecessors of node i until the prefix sum
+    for (unsigned long i = 0; i < m; ++i) graph->reverse_offsets[graph->targets[i] + 1]++;
+    for (unsigned long i = 0; i < n; ++i) graph->reverse_offsets[i + 1] += graph->reverse_offsets[i];
+    memcpy(next_position, graph->reverse_offsets, (n + 1) * sizeof(uint32_t));
+
+    for (unsigned long tail = 0; tail < n; ++tail) {
+        for (uint32_t i = graph->offsets[tail]; i < graph->offsets[tail + 1]; ++i) {
+            uint32_t position = next_position[graph->targets[i]]++;
+            graph->sources[position] = (uint32_t) tail;
+            graph->reverse_weights[position] = graph->weights[i];
+        }
+    }
+    free(next_position);
+}
+
+
+unsigned long id_index_size(unsigned long nr_of_nodes) {
+    // number of slots of the id index, a power of two with at most half of the slots in use
+    unsigned long size = 16;
+
+    while (size < 2 * nr_of_nodes) size *= 2;
+    return size;
+}
+
+void build_id_index(Graph *graph) {
+    // builds the open addressing hash table from node ids to node indices used by get_node_by_id
+    // every slot holds a node index or UINT32_MAX if it is empty, collisions go to the next slot
+
+    unsigned long mask;
+    unsigned long slot;
+
+    graph->id_index_size = id_index_size(graph->nr_of_nodes);
+    if ((graph->id_index = malloc(graph->id_index_size * sizeof(uint32_t))) == NULL) exit(1);
+    memset(graph->id_index, 0xff, graph->id_index_size * sizeof(uint32_t));
+
+    mask = graph->id_index_size - 1;
+    for (unsigned long i = 0; i < graph->nr_of_nodes; ++i) {
+        slot = id_hash(graph->ids[i]) & mask;
+        while (graph->id_index[slot] != UINT32_MAX) {
+            // a duplicate id keeps its first node, like the binary search would find one of them
+            if (graph->ids[graph->id_index[slot]] == graph->ids[i]) break;
+            slot = (slot + 1) & mask;
+        }
+        if (graph->id_index[slot] == UINT32_MAX) graph->id_index[slot] = (uint32_t) i;
+    }
+}
+
+static uint64_t hilbert_index(uint32_t x, uint32_t y) {
+    // position of the cell (x, y) on the Hilbert curve through a grid of 2^HILBERT_BITS x 2^HILBERT_BITS cells
+    uint32_t side = 1u << HILBERT_BITS;
+    uint32_t rx, ry, swap;
+    uint64_t index = 0;
+
+    for (uint32_t s = side / 2; s > 0; s /= 2) {
+        rx = (x & s) > 0;
+        ry = (y & s) > 0;
+        index += (uint64_t) s * s * ((3 * rx) ^ ry);
+        // rotate the quadrant so the curve continues in it
+        if (ry == 0) {
+            if (rx == 1) {
+                x = side - 1 - x;
+                y = side - 1 - y;
+            }
+            swap = x;
+            x = y;
+            y = swap;
+        }
+    }
+    return index;
+}
+
+static int compare_keys(const void *a, const void *b) {
+    uint64_t key_a = *(const uint64_t *) a;
+    uint64_t key_b = *(const uint64_t *) b;
+    return (key_a > key_b) - (key_a < key_b);
+}
+
+static void hilbert_order(Graph *graph, uint32_t *new_to_old) {
+    // orders the nodes along a Hilbert curve over their bounding box
+    // the key is the curve position in the upper and the old index in the lower 32 bits, so ties keep their order
+
+    unsigned long n = graph->nr_of_nodes;
+    double min_lat = DBL_MAX, max_lat = -DBL_MAX, min_lon = DBL_MAX, max_lon = -DBL_MAX;
+    double cells = (double) ((1u << HILBERT_BITS) - 1);
+    uint64_t *keys;
+    uint32_t x, y;
+
+    if ((keys = malloc(n * sizeof(uint64_t))) == NULL) exit(1);
+    for (unsigned long i = 0; i < n; ++i) {
+        if (node_lat(graph, i) < min_lat) min_lat = node_lat(graph, i);
+        if (node_lat(graph, i) > max_lat) max_lat = node_lat(graph, i);
+        if (node_lon(graph, i) < min_lon) min_lon = node_lon(graph, i);
+        if (node_lon(graph, i) > max_lon) max_lon = node_lon(graph, i);
+    }
+    for (unsigned long i = 0; i < n; ++i) {
+        x = (uint32_t) (max_lon > min_lon ? (node_lon(graph, i) - min_lon) / (max_lon - min_lon) * cells : 0);
+        y = (uint32_t) (max_lat > min_lat ? (node_lat(graph, i) - min_lat) / (max_lat - min_lat) * cells : 0);
+        keys[i] = hilbert_index(x, y) << 32 | i;
+    }
+    qsort(keys, n, sizeof(uint64_t), compare_keys);
+    for (unsigned long i = 0; i < n; ++i) {
+        new_to_old[i] = (uint32_t) keys[i];
+    }
+    free(keys);
+}
+
+static void bfs_order(Graph *graph, uint32_t *new_to_old) {
+    // orders the nodes by breadth first search over successors and predecessors,
+    // every component starts at its node with the smallest index
+    // new_to_old is also the queue of the search
+
+    unsigned long n = graph->nr_of_nodes;
+    unsigned long head = 0, tail = 0;
+    bool *visited;
+    uint32_t node;
+
+    if ((visited = calloc(n, sizeof(bool))) == NULL) exit(1);
+    for (unsigned long root = 0; root < n; ++root) {
+        if (visited[root]) continue;
+        visited[root] = true;
+        new_to_old[tail++] = (uint32_t) root;
+        while (head < tail) {
+            node = new_to_old[head++];
+            for (uint32_t i = graph->offsets[node]; i < graph->offsets[node + 1]; ++i) {
+                if (!visited[graph->targets[i]]) {
+                    visited[graph->targets[i]] = true;
+                    new_to_old[tail++] = graph->targets[i];
+                }
+            }
+            for (uint32_t i = graph->reverse_offsets[node]; i < graph->reverse_offsets[node + 1]; ++i) {
+                if (!visited[graph->sources[i]]) {
+                    visited[graph->sources[i]] = true;
+                    new_to_old[tail++] = graph->sources[i];
+                }
+            }
+        }
+    }
+    free(visited);
+}
+
+static void *permute_nodes(void *array, size_t element_size, const uint32_t *new_to_old, unsigned long n) {
+    // returns a copy of a node array in the new order and frees the old one, NULL stays NULL
+    char *permuted;
+
+    if (array == NULL) return NULL;
+    if ((permuted = malloc(n * element_size)) == NULL) exit(1);
+    for (unsigned long i = 0; i < n; ++i) {
+        memcpy(permuted + i * element_size, (char *) array + new_to_old[i] * element_size, element_size);
+    }
+    free(array);
+    return permuted;
+}
+
+void reorder_graph(Graph *graph, NodeOrder order) {
+    // renumbers the nodes of a graph built in memory so that nodes close in the road network are close in memory
+    // the successors of every node keep their order, the reverse graph and the id index are built again
+    // afterwards the ids are no longer sorted, ids are then only looked up with the id index
+
+    unsigned long n = graph->nr_of_nodes;
+    uint32_t *new_to_old, *old_to_new;
+    uint32_t *offsets, *targets;
+    float *weights;
+    uint32_t old;
+
+    if (order == ID_ORDER) return;
+    new_to_old = malloc(n * sizeof(uint32_t));
+    old_to_new = malloc(n * sizeof(uint32_t));
+    offsets = malloc((n + 1) * sizeof(uint32_t));
+    targets = malloc(graph->nr_of_edges * sizeof(uint32_t));
+    weights = malloc(graph->nr_of_edges * sizeof(float));
+    if (new_to_old == NULL || old_to_new == NULL || offsets == NULL || targets == NULL || weights == NULL) exit(1);
+
+    if (order == HILBERT_ORDER) {
+        hilbert_order(graph, new_to_old);
+    } else {
+        bfs_order(graph, new_to_old);
+    }
+    for (unsigned long i = 0; i < n; ++i) old_to_new[new_to_old[i]] = (uint32_t) i;
+
+    offsets[0] = 0;
+    for (unsigned long i = 0; i < n; ++i) {
+        old = new_to_old[i];
+        offsets[i + 1] = offsets[i];
+        for (uint32_t j = graph->offsets[old]; j < graph->offsets[old + 1]; ++j) {
+            targets[offsets[i + 1]] = old_to_new[graph->targets[j]];
+            weights[offsets[i + 1]++] = graph->weights[j];
+        }
+    }
+    // only one of the two coordinate pairs is set, see to_fixed_coordinates
+    graph->ids = permute_nodes(graph->ids, sizeof(uint64_t), new_to_old, n);
+    graph->lat = permute_nodes(graph->lat, sizeof(double), new_to_old, n);
+    graph->lon = permute_nodes(graph->lon, sizeof(double), new_to_old, n);
+    graph->lat_e7 = permute_nodes(graph->lat_e7, sizeof(int32_t), new_to_old, n);
+    graph->lon_e7 = permute_nodes(graph->lon_e7, sizeof(int32_t), new_to_old, n);
+    graph->unit_x = permute_nodes(graph->unit_x, sizeof(double), new_to_old, n);
+    graph->unit_y = permute_nodes(graph->unit_y, sizeof(double), new_to_old, n);
+    graph->unit_z = permute_nodes(graph->unit_z, sizeof(double), new_to_old, n);
+    free(new_to_old);
+    free(old_to_new);
+
+    free(graph->offsets);
+    free(graph->targets);
+    free(graph->weights);
+    free(graph->reverse_offsets);
+    free(graph->sources);
+    free(graph->reverse_weights);
+    free(graph->id_index);
+    graph->offsets = offsets;
+    graph->targets = targets;
+    graph->weights = weights;
+    graph->ids_sorted = false;
+    build_reverse_graph(graph);
+    build_id_index(graph);
+}
+
+void to_fixed_coordinates(Graph *graph) {
+    // replaces the double coordinates of a graph built in memory by 32 bit fixed-point coordinates in 1e-7 degrees
+    // half the memory and the rounding error of at most 0.5e-7 degrees (about 6 mm) is far below the precision
+    // of the OpenStreetMap data, which has 7 decimals
+
+    unsigned long n = graph->nr_of_nodes;
+
+    graph->lat_e7 = malloc(n * sizeof(int32_t));
+    graph->lon_e7 = malloc(n * sizeof(int32_t));
+    if (graph->lat_e7 == NULL || graph->lon_e7 == NULL) exit(1);
+    for (unsigned long i = 0; i < n; ++i) {
+        graph->lat_e7[i] = (int32_t) lround(graph->lat[i] * COORDINATE_SCALE);
+        graph->lon_e7[i] = (int32_t) lround(graph->lon[i] * COORDINATE_SCALE);
+    }
+    free(graph->lat);
+    free(graph->lon);
+    graph->lat = graph->lon = NULL;
+}
+
+bool parse_node_order(const char *name, NodeOrder *order) {
+    // converts the name of a node order (id, hilbert or bfs) into a NodeOrder
+    // returns false if the name is unknown
+
+    if (strcmp(name, "id") == 0) *order = ID_ORDER;
+    else if (strcmp(name, "hilbert") == 0) *order = HILBERT_ORDER;
+    else if (strcmp(name, "bfs") == 0) *order = BFS_ORDER;
+    else return false;
+    return true;
+}
+
+static bool is_routable(Graph *graph, unsigned long index) {
+    // a node without any edge can not be the start or the goal of a route
+    return graph->offsets[index + 1] > graph->offsets[index] ||
+           graph->reverse_offsets[index + 1] > graph->reverse_offsets[index];
+}
+
+static uint32_t grid_position(double value, double min, double cell_size, uint32_t nr_of_cells) {
+    // column or row of a coordinate, coordinates outside of the grid go to the nearest border cell
+    double position = floor((value - min) / cell_size);
+
+    if (!(position > 0)) return 0; // also NaN
+    if (position >= nr_of_cells) return nr_of_cells - 1;
+    return (uint32_t) position;
+}
+
+uint64_t spatial_index_size(SpatialIndex *spatial_index) {
+    // size in bytes of the spatial index with its cell offsets and cell nodes
+    return sizeof(SpatialIndex) + ((uint64_t) spatial_index->columns * spatial_index->rows + 1) * sizeof(uint32_t) +
+           (uint64_t) spatial_index->nr_of_indexed_nodes * sizeof(uint32_t);
+}
+
+void build_spatial_index(Graph *graph) {
+    // builds the grid of the routable nodes used by nearest_node, the reverse graph has to exist
+    // the cells are about square in metres with SPATIAL_NODES_PER_CELL nodes on average,
+    // the nodes are sorted into their cells with a counting sort, so every cell keeps the order of the indices
+
+    SpatialIndex grid = {.min_lat = DBL_MAX, .min_lon = DBL_MAX, .columns = 1, .rows = 1, .nr_of_indexed_nodes = 0};
+    double max_lat = -DBL_MAX, max_lon = -DBL_MAX;
+    double metres_per_degree = R * M_PI / 180, longitude_scale;
+    double width, height, nr_of_cells, cell_size;
+    uint32_t *offsets, *nodes, *next_position;
+    uint64_t cell;
+
+    for (unsigned long i = 0; i < graph->nr_of_nodes; ++i) {
+        if (!is_routable(graph, i)) continue;
+        grid.nr_of_indexed_nodes++;
+        if (node_lat(graph, i) < grid.min_lat) grid.min_lat = node_lat(graph, i);
+        if (node_lat(graph, i) > max_lat) max_lat = node_lat(graph, i);
+        if (node_lon(graph, i) < grid.min_lon) grid.min_lon = node_lon(graph, i);
+        if (node_lon(graph, i) > max_lon) max_lon = node_lon(graph, i);
+    }
+    if (grid.nr_of_indexed_nodes == 0) {
+        grid.min_lat = grid.min_lon = 0;
+        max_lat = max_lon = 0;
+    }
+
+    // the cell size in metres from the area, but at least so many metres that a long thin box gets few cells
+    longitude_scale = fmax(cos((grid.min_lat + max_lat) / 2 * M_PI / 180), 1e-6);
+    height = (max_lat - grid.min_lat) * metres_per_degree;
+    width = (max_lon - grid.min_lon) * metres_per_degree * longitude_scale;
+    nr_of_cells = ceil((double) grid.nr_of_indexed_nodes / SPATIAL_NODES_PER_CELL);
+    cell_size = fmax(fmax(sqrt(width * height / nr_of_cells), fmax(width, height) / nr_of_cells), 1.0);
+    grid.cell_lat = cell_size / metres_per_degree;
+    grid.cell_lon = grid.cell_lat / longitude_scale;
+    grid.columns = (uint32_t) (width / cell_size) + 1;
+    grid.rows = (uint32_t) (height / cell_size) + 1;
+
+    if ((graph->spatial_index = malloc(spatial_index_size(&grid))) == NULL) exit(1);
+    *graph->spatial_index = grid;
+    offsets = cell_offsets(graph->spatial_index);
+    nodes = cell_nodes(graph->spatial_index);
+    memset(offsets, 0, ((uint64_t) grid.columns * grid.rows + 1) * sizeof(uint32_t));
+    if ((next_position = malloc(((uint64_t) grid.columns * grid.rows + 1) * sizeof(uint32_t))) == NULL) exit(1);
+
+    // offsets[c+1] counts the nodes of cell c until the prefix sum
+    for (unsigned long i = 0; i < graph->nr_of_nodes; ++i) {
+        if (!is_routable(graph, i)) continue;
+        cell = (uint64_t) grid_position(node_lat(graph, i), grid.min_lat, grid.cell_lat, grid.rows) * grid.columns +
+               grid_position(node_lon(graph, i), grid.min_lon, grid.cell_lon, grid.columns);
+        offsets[cell + 1]++;
+    }
+    for (uint64_t c = 0; c < (uint64_t) grid.columns * grid.rows; ++c) offsets[c + 1] += offsets[c];
+    memcpy(next_position, offsets, ((uint64_t) grid.columns * grid.rows + 1) * sizeof(uint32_t));
+    for (unsigned long i = 0; i < graph->nr_of_nodes; ++i) {
+        if (!is_routable(graph, i)) continue;
+        cell = (uint64_t) grid_position(node_lat(graph, i), grid.min_lat, grid.cell_lat, grid.rows) * grid.columns +
+               grid_position(node_lon(graph, i), grid.min_lon, grid.cell_lon, grid.columns);
+        nodes[next_position[cell]++] = (uint32_t) i;
+    }
+    free(next_position);
+}
+
+static double band_gap(double value, double min, double cell_size, long position) {
+    // distance in degrees from a coordinate to the row or column of cells at position, 0 inside of it
+    double low = min + position * cell_size;
+
+    return fmax(fmax(low - value, value - (low + cell_size)), 0);
+}
+
+static void scan_cell(Graph *graph, uint64_t cell, double lat, double lon, double metres_per_degree_lon,
+                      double *best_squared_distance, unsigned long *best_index) {
+    // looks for a node closer than the best one in a cell of the spatial index
+    uint32_t *offsets = cell_offsets(graph->spatial_index);
+    uint32_t *nodes = cell_nodes(graph->spatial_index);
+    double metres_per_degree = R * M_PI / 180;
+    double squared_distance, dy, dx;
+
+    for (uint32_t i = offsets[cell]; i < offsets[cell + 1]; ++i) {
+        dy = (node_lat(graph, nodes[i]) - lat) * metres_per_degree;
+        dx = (node_lon(graph, nodes[i]) - lon) * metres_per_degree_lon;
+        squared_distance = dy * dy + dx * dx;
+        if (squared_distance < *best_squared_distance) {
+            *best_squared_distance = squared_distance;
+            *best_index = nodes[i];
+        }
+    }
+}
+
+unsigned long nearest_node(Graph *graph, double lat, double lon, double *distance) {
+    // returns the index of the routable node closest to the coordinates (in degrees) and its distance in metres
+    // the cells are searched in growing square rings around the cell of the coordinates until the next ring is
+    // farther away than the closest node found, so only a few cells are looked at
+    // a ring is as far away as the nearest of its rows and columns inside of the grid, and of a wider ring only the
+    // cells which can be closer than the closest node are looked at: near the poles or far from the grid a degree of
+    // longitude is almost no metres, the rings then only end at the border of the grid, but each of them only has a
+    // few cells close enough
+    // the distances are equirectangular around the coordinates, exact enough over a few cells
+    // returns ULONG_MAX if the graph has no routable node
+
+    SpatialIndex *grid = graph->spatial_index;
+    double metres_per_degree = R * M_PI / 180;
+    double metres_per_degree_lon = metres_per_degree * cos(lat * M_PI / 180);
+    double best_squared_distance = DBL_MAX, ring_squared_distance, gap, reach;
+    unsigned long best_index = ULONG_MAX;
+    long column = grid_position(lon, grid->min_lon, grid->cell_lon, grid->columns);
+    long row = grid_position(lat, grid->min_lat, grid->cell_lat, grid->rows);
+    // the ring which reaches the farthest border of the grid
+    long last_ring = (long) fmax(fmax(column, grid->columns - 1 - column), fmax(row, grid->rows - 1 - row));
+    // distances of the coordinates from their row and column, not 0 only outside of the grid
+    double row_gap = band_gap(lat, grid->min_lat, grid->cell_lat, row) * metres_per_degree;
+    double column_gap = band_gap(lon, grid->min_lon, grid->cell_lon, column) * metres_per_degree_lon;
+    // the coordinates in cells from the south-west corner, also outside of the grid
+    double row_position = (lat - grid->min_lat) / grid->cell_lat;
+    double column_position = (lon - grid->min_lon) / grid->cell_lon;
+    long first, last;
+
+    if (grid->nr_of_indexed_nodes == 0) return ULONG_MAX;
+    scan_cell(graph, (uint64_t) row * grid->columns + (uint64_t) column, lat, lon, metres_per_degree_lon,
+              &best_squared_distance, &best_index);
+    for (long ring = 1; ring <= last_ring; ++ring) {
+        // the nodes of the ring are in its bottom and top row, at least as far from the coordinates as the row and
+        // as the column of the coordinates, or in its left and right column, as far as the column and as the row
+        // (coordinates outside of the grid are farther away from every cell than from their border cell)
+        ring_squared_distance = DBL_MAX;
+        if (row - ring >= 0) {
+            gap = band_gap(lat, grid->min_lat, grid->cell_lat, row - ring) * metres_per_degree;
+            ring_squared_distance = fmin(ring_squared_distance, gap * gap + column_gap * column_gap);
+        }
+        if (row + ring < grid->rows) {
+            gap = band_gap(lat, grid->min_lat, grid->cell_lat, row + ring) * metres_per_degree;
+            ring_squared_distance = fmin(ring_squared_distance, gap * gap + column_gap * column_gap);
+        }
+        if (column - ring >= 0) {
+            gap = band_gap(lon, grid->min_lon, grid->cell_lon, column - ring) * metres_per_degree_lon;
+            ring_squared_distance = fmin(ring_squared_distance, gap * gap + row_gap * row_gap);
+        }
+        if (column + ring < grid->columns) {
+            gap = band_gap(lon, grid->min_lon, grid->cell_lon, column + ring) * metres_per_degree_lon;
+            ring_squared_distance = fmin(ring_squared_distance, gap * gap + row_gap * row_gap);
+        }
+        if (ring_squared_distance >= best_squared_distance) break;
+
+        // the bottom and the top row of the ring and the left and the right column between them, beyond the short
+        // rings only the cells within reach of the closest node (in cells, a degree of longitude can be 0 metres)
+        for (long y = row - ring; y <= row + ring; y += 2 * ring) {
+            if (y < 0 || y >= grid->rows) continue;
+            gap = band_gap(lat, grid->min_lat, grid->cell_lat, y) * metres_per_degree;
+            if (gap * gap >= best_squared_distance) continue;
+            first = column - ring < 0 ? 0 : column - ring;
+            last = column + ring >= grid->columns ? grid->columns - 1 : column + ring;
+            if (ring > SPATIAL_SHORT_RING) {
+                reach = sqrt(best_squared_distance - gap * gap) / fmax(metres_per_degree_lon * grid->cell_lon, 1e-9);
+                first = (long) fmax(first, floor(column_position - reach));
+                last = (long) fmin(last, floor(column_position + reach));
+            }
+            for (long x = first; x <= last; ++x) {
+                scan_cell(graph, (uint64_t) y * grid->columns + (uint64_t) x, lat, lon, metres_per_degree_lon,
+                          &best_squared_distance, &best_index);
+            }
+        }
+        for (long x = column - ring; x <= column + ring; x += 2 * ring) {
+            if (x < 0 || x >= grid->columns) continue;
+            gap = band_gap(lon, grid->min_lon, grid->cell_lon, x) * metres_per_degree_lon;
+            if (gap * gap >= best_squared_distance) continue;
+            first = row - ring + 1 < 0 ? 0 : row - ring + 1;
+            last = row + ring - 1 >= grid->rows ? grid->rows - 1 : row + ring - 1;
+            if (ring > SPATIAL_SHORT_RING) {
+                reach = sqrt(best_squared_distance - gap * gap) / (metres_per_degree * grid->cell_lat);
+                first = (long) fmax(first, floor(row_position - reach));
+                last = (long) fmin(last, floor(row_position + reach));
+            }
+            for (long y = first; y <= last; ++y) {
+                scan_cell(graph, (uint64_t) y * grid->columns + (uint64_t) x, lat, lon, metres_per_degree_lon,
+                          &best_squared_distance, &best_index);
+            }
+        }
+    }
+    *distance = sqrt(best_squared_distance);
+    return best_index;
+}
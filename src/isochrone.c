@@ -0,0 +1,138 @@
+// isochrone.c
+// finds the nodes within a distance of many depots (service areas) against one loaded graph
+// part of the command line tool, it only uses the library interface of libastar.h
+
+
+#include "astar.h"
+
+static void* isochrone_worker(void* argument)
+{
+    // takes the next depot until all of the block are done, the reached nodes are copied out of the query handle
+    // because it is reused by the next depot
+
+    IsochroneContext* context = argument;
+    unsigned long worker = __sync_fetch_and_add(&context->next_worker, 1);
+    AStarQuery* router = context->routers[worker];
+    Isochrone* isochrone;
+    AStarReach reach;
+    unsigned long depot;
+
+    while ((depot = __sync_fetch_and_add(&context->next_depot, 1))<context->end_depot) {
+        isochrone = &context->isochrones[depot-context->first_depot];
+        if (astar_isochrone(router, context->depots[depot], context->max_distance, &reach)!=ASTAR_OK) {
+            fprintf(stderr, "Unknown depot %lu, no nodes are reached.\n", (unsigned long) context->depots[depot]);
+        }
+        isochrone->nr_of_nodes = reach.nr_of_nodes;
+        if (reach.nr_of_nodes+1>isochrone->capacity) {
+            isochrone->capacity = reach.nr_of_nodes+1;
+            isochrone->ids = realloc(isochrone->ids, isochrone->capacity*sizeof(uint64_t));
+            isochrone->distances = realloc(isochrone->distances, isochrone->capacity*sizeof(double));
+            if (isochrone->ids==NULL || isochrone->distances==NULL) exit(1);
+        }
+        if (reach.nr_of_nodes>0) {
+            memcpy(isochrone->ids, reach.ids, reach.nr_of_nodes*sizeof(uint64_t));
+            memcpy(isochrone->distances, reach.distances, reach.nr_of_nodes*sizeof(double));
+        }
+    }
+    return NULL;
+}
+
+static void write_isochrone(FILE* fout, IsochroneContext* context, unsigned long depot, OutputFormat format)
+{
+    // csv: one line "depot_id,node_id,distance" per reached node
+    // binary: the depot id and the number of nodes as uint64, the node ids (uint64) and their distances (float)
+
+    Isochrone* isochrone = &context->isochrones[depot-context->first_depot];
+
+    if (format==BINARY_OUTPUT) {
+        uint64_t sizes[2] = {context->depots[depot], isochrone->nr_of_nodes};
+        if (isochrone->nr_of_nodes>context->binary_capacity) {
+            context->binary_capacity = isochrone->nr_of_nodes;
+            context->binary_distances = realloc(context->binary_distances, context->binary_capacity*sizeof(float));
+            if (context->binary_distances==NULL) exit(1);
+        }
+        for (unsigned long i = 0; i<isochrone->nr_of_nodes; ++i) {
+            context->binary_distances[i] = (float) isochrone->distances[i];
+        }
+        fwrite(sizes, sizeof(uint64_t), 2, fout);
+        fwrite(isochrone->ids, sizeof(uint64_t), isochrone->nr_of_nodes, fout);
+        fwrite(context->binary_distances, sizeof(float), isochrone->nr_of_nodes, fout);
+        return;
+    }
+    for (unsigned long i = 0; i<isochrone->nr_of_nodes; ++i) {
+        fprintf(fout, "%lu,%lu,%.2f\n", (unsigned long) context->depots[depot], (unsigned long) isochrone->ids[i],
+                isochrone->distances[i]);
+    }
+}
+
+AStarCode run_isochrones(char* depots_filename, double max_distance, AStarGraph* graph, const AStarOptions* options,
+        unsigned int nr_of_threads, OutputFormat format)
+{
+    // finds the nodes within max_distance metres of every depot of depots_filename (see read_ids) with
+    // nr_of_threads worker threads and writes them to stdout in the order of the depots, each by ascending distance:
+    // csv with a header line "depot,node,distance", binary starts with ISOCHRONE_MAGIC and the number of depots
+    // (uint64), see write_isochrone
+    // the depots are done in blocks of ISOCHRONE_DEPOTS_PER_THREAD per thread and each block is written before the
+    // next one starts, so only the reached nodes of one block are kept and not those of all depots
+    // an unknown depot reaches no nodes, the time of the searches goes to stderr
+    // returns the code of astar_query_create, ASTAR_OPEN_ERROR if the depots can not be read or ASTAR_WRITE_ERROR
+
+    IsochroneContext context = {.max_distance=max_distance};
+    struct timespec start, end;
+    double milliseconds = 0;
+    unsigned long block_size = (unsigned long) nr_of_threads*ISOCHRONE_DEPOTS_PER_THREAD;
+    unsigned long nr_of_reached_nodes = 0;
+    uint64_t nr_of_depots;
+    AStarCode code = ASTAR_OK;
+
+    context.routers = calloc(nr_of_threads, sizeof(AStarQuery*));
+    if (context.routers==NULL) exit(1);
+    for (unsigned int i = 0; i<nr_of_threads && code==ASTAR_OK; ++i) {
+        code = astar_query_create(graph, options, &context.routers[i]);
+    }
+
+    if (code==ASTAR_OK && (context.depots = read_ids(depots_filename, &context.nr_of_depots))==NULL) {
+        code = ASTAR_OPEN_ERROR;
+    }
+    if (code==ASTAR_OK) {
+        if ((context.isochrones = calloc(block_size, sizeof(Isochrone)))==NULL) exit(1);
+
+        if (format==BINARY_OUTPUT) {
+            nr_of_depots = context.nr_of_depots;
+            fwrite(ISOCHRONE_MAGIC, 1, 8, stdout);
+            fwrite(&nr_of_depots, sizeof(uint64_t), 1, stdout);
+        }
+        else {
+            fputs("depot,node,distance\n", stdout);
+        }
+        for (context.first_depot = 0; context.first_depot<context.nr_of_depots; context.first_depot += block_size) {
+            context.end_depot = context.first_depot+block_size<context.nr_of_depots ?
+                    context.first_depot+block_size : context.nr_of_depots;
+            context.next_depot = context.first_depot;
+            context.next_worker = 0;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            run_parallel(nr_of_threads, isochrone_worker, &context);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            milliseconds += elapsed_milliseconds(start, end);
+
+            for (unsigned long i = context.first_depot; i<context.end_depot; ++i) {
+                write_isochrone(stdout, &context, i, format);
+                nr_of_reached_nodes += context.isochrones[i-context.first_depot].nr_of_nodes;
+            }
+        }
+        if (fflush(stdout)!=0 || ferror(stdout)) code = ASTAR_WRITE_ERROR;
+        fprintf(stderr, "Reached %lu nodes from %lu depot(s) in %.3f ms with %u thread(s).\n", nr_of_reached_nodes,
+                context.nr_of_depots, milliseconds, nr_of_threads);
+        for (unsigned long i = 0; i<block_size; ++i) {
+            free(context.isochrones[i].ids);
+            free(context.isochrones[i].distances);
+        }
+        free(context.isochrones);
+        free(context.binary_distances);
+        free(context.depots);
+    }
+
+    for (unsigned int i = 0; i<nr_of_threads; ++i) astar_query_free(context.routers[i]);
+    free(context.routers);
+    return code;
+}
@@ -0,0 +1,190 @@
+// landmarks.c
+// ALT heuristic (A*, Landmarks, Triangle inequality)
+// for a few landmark nodes the distances from and to every node are precomputed and stored next to the .bin
+// by the triangle inequality they give lower bounds on the distance between any two nodes
+
+
+#include "astar.h"
+
+static unsigned long farthest_node(double* min_distance, unsigned long nr_of_nodes)
+{
+    // returns the node with the largest distance to the landmarks chosen so far
+    // nodes no landmark reaches (DBL_MAX) are skipped, ULONG_MAX if there is no candidate left
+    unsigned long farthest = ULONG_MAX;
+    double farthest_distance = 0;
+
+    for (unsigned long i = 0; i<nr_of_nodes; ++i) {
+        if (min_distance[i]<DBL_MAX && min_distance[i]>farthest_distance) {
+            farthest_distance = min_distance[i];
+            farthest = i;
+        }
+    }
+    return farthest;
+}
+
+static void fill_landmark_table(float* table, unsigned long nr_of_landmarks, unsigned long landmark,
+        SearchWorkspace* workspace, unsigned long nr_of_nodes)
+{
+    // copies the distances of a finished dijkstra into column landmark of a node major table
+    // unreached nodes get -1
+    for (unsigned long i = 0; i<nr_of_nodes; ++i) {
+        table[i*nr_of_landmarks+landmark] = is_reached(workspace, i) ? (float) workspace->status_list[i].g : -1;
+    }
+}
+
+void build_landmarks(Graph* graph, unsigned long nr_of_landmarks, QueueType queue_type, Landmarks* landmarks)
+{
+    // chooses the landmarks by farthest selection and computes their distance tables
+    // the first landmark is the node farthest from node 0, every further one the node
+    // farthest from all landmarks chosen so far
+    // for each landmark one forward and one backward dijkstra over the whole graph is needed
+
+    unsigned long n = graph->nr_of_nodes;
+    SearchWorkspace workspace;
+    double* min_distance;
+    unsigned long landmark_index;
+
+    memset(landmarks, 0, sizeof(Landmarks));
+    landmarks->indices = malloc(nr_of_landmarks*sizeof(uint32_t));
+    landmarks->from_landmark = malloc(n*nr_of_landmarks*sizeof(float));
+    landmarks->to_landmark = malloc(n*nr_of_landmarks*sizeof(float));
+    min_distance = malloc(n*sizeof(double));
+    if (landmarks->indices==NULL || landmarks->from_landmark==NULL || landmarks->to_landmark==NULL ||
+            min_distance==NULL)
+        exit(1);
+
+    init_workspace(&workspace, n, queue_type);
+
+    dijkstra(0, graph, &workspace, false, DBL_MAX, NULL);
+    for (unsigned long i = 0; i<n; ++i) min_distance[i] = is_reached(&workspace, i) ? workspace.status_list[i].g : DBL_MAX;
+    landmark_index = farthest_node(min_distance, n);
+    if (landmark_index==ULONG_MAX) landmark_index = 0;
+    for (unsigned long i = 0; i<n; ++i) min_distance[i] = DBL_MAX;
+
+    while (landmarks->nr_of_landmarks<nr_of_landmarks && landmark_index!=ULONG_MAX) {
+        landmarks->indices[landmarks->nr_of_landmarks] = (uint32_t) landmark_index;
+
+        dijkstra(landmark_index, graph, &workspace, false, DBL_MAX, NULL);
+        fill_landmark_table(landmarks->from_landmark, nr_of_landmarks, landmarks->nr_of_landmarks, &workspace, n);
+        for (unsigned long i = 0; i<n; ++i) {
+            if (is_reached(&workspace, i) && workspace.status_list[i].g<min_distance[i]) {
+                min_distance[i] = workspace.status_list[i].g;
+            }
+        }
+
+        dijkstra(landmark_index, graph, &workspace, true, DBL_MAX, NULL);
+        fill_landmark_table(landmarks->to_landmark, nr_of_landmarks, landmarks->nr_of_landmarks, &workspace, n);
+
+        landmarks->nr_of_landmarks++;
+        landmark_index = farthest_node(min_distance, n);
+    }
+
+    // the tables were laid out for nr_of_landmarks columns, with fewer landmarks (tiny graphs) they are repacked
+    if (landmarks->nr_of_landmarks<nr_of_landmarks) {
+        for (unsigned long i = 0; i<n; ++i) {
+            for (unsigned long l = 0; l<landmarks->nr_of_landmarks; ++l) {
+                landmarks->from_landmark[i*landmarks->nr_of_landmarks+l] = landmarks->from_landmark[i*nr_of_landmarks+l];
+                landmarks->to_landmark[i*landmarks->nr_of_landmarks+l] = landmarks->to_landmark[i*nr_of_landmarks+l];
+            }
+        }
+    }
+
+    free(min_distance);
+    free_workspace(&workspace);
+}
+
+int write_landmark_file(const char* filename, Graph* graph, Landmarks* landmarks)
+{
+    // writes the landmark tables in the page aligned layout of the graph file, so they can be mapped as well
+    // returns 0, ASTAR_OPEN_ERROR or ASTAR_WRITE_ERROR
+
+    FILE* fout;
+    LandmarkFileHeader header;
+    int code;
+    unsigned long table_size = graph->nr_of_nodes*landmarks->nr_of_landmarks*sizeof(float);
+    void* data[LANDMARK_SECTIONS] = {landmarks->indices, landmarks->from_landmark, landmarks->to_landmark};
+    uint64_t size[LANDMARK_SECTIONS] = {landmarks->nr_of_landmarks*sizeof(uint32_t), table_size, table_size};
+
+    memset(&header, 0, sizeof(LandmarkFileHeader));
+    memcpy(header.magic, LANDMARK_MAGIC, sizeof(header.magic));
+    header.version = GRAPH_VERSION;
+    header.endianness = GRAPH_ENDIANNESS;
+    header.nr_of_nodes = graph->nr_of_nodes;
+    header.nr_of_edges = graph->nr_of_edges;
+    header.fingerprint = graph->fingerprint;
+    header.nr_of_landmarks = landmarks->nr_of_landmarks;
+
+    if ((fout = fopen(filename, "wb"))==NULL) return ASTAR_OPEN_ERROR;
+    code = write_sections(fout, &header, sizeof(LandmarkFileHeader), header.sections, data, size, LANDMARK_SECTIONS);
+    if (fclose(fout)!=0 && code==0) code = ASTAR_WRITE_ERROR;
+    return code;
+}
+
+int read_landmark_file(const char* filename, Graph* graph, Landmarks* landmarks)
+{
+    // maps a landmark file written by write_landmark_file for the given graph
+    // returns 0 or the code of map_file, a file of another graph (size or fingerprint) or version and a file whose
+    // sections do not fit are rejected with ASTAR_READ_ERROR and leave nothing mapped
+
+    LandmarkFileHeader* header;
+    unsigned long table_size;
+    bool valid = true;
+    int code;
+
+    memset(landmarks, 0, sizeof(Landmarks));
+    code = map_file(filename, sizeof(LandmarkFileHeader), &landmarks->mapping, &landmarks->mapping_size);
+    if (code!=0) return code;
+    header = landmarks->mapping;
+    if (memcmp(header->magic, LANDMARK_MAGIC, sizeof(header->magic))!=0 || header->version!=GRAPH_VERSION ||
+            header->endianness!=GRAPH_ENDIANNESS || header->nr_of_nodes!=graph->nr_of_nodes ||
+            header->nr_of_edges!=graph->nr_of_edges || header->fingerprint!=graph->fingerprint) {
+        free_landmarks(landmarks);
+        return ASTAR_READ_ERROR;
+    }
+
+    landmarks->nr_of_landmarks = header->nr_of_landmarks;
+    table_size = graph->nr_of_nodes*landmarks->nr_of_landmarks*sizeof(float);
+    landmarks->indices = map_section(header, landmarks->mapping_size, &header->sections[0],
+            landmarks->nr_of_landmarks*sizeof(uint32_t), &valid);
+    landmarks->from_landmark = map_section(header, landmarks->mapping_size, &header->sections[1], table_size, &valid);
+    landmarks->to_landmark = map_section(header, landmarks->mapping_size, &header->sections[2], table_size, &valid);
+    if (!valid) {
+        free_landmarks(landmarks);
+        return ASTAR_READ_ERROR;
+    }
+    return 0;
+}
+
+void free_landmarks(Landmarks* landmarks)
+{
+    if (landmarks->mapping!=NULL) {
+        munmap(landmarks->mapping, landmarks->mapping_size);
+    }
+    else {
+        free(landmarks->indices);
+        free(landmarks->from_landmark);
+        free(landmarks->to_landmark);
+    }
+    memset(landmarks, 0, sizeof(Landmarks));
+}
+
+double landmark_distance(unsigned long node_a_index, unsigned long node_b_index, Graph* graph)
+{
+    // returns the ALT lower bound on the distance from node a to node b
+    // for every landmark L: d(a,b) >= d(L,b)-d(L,a) and d(a,b) >= d(a,L)-d(b,L)
+    // distances of -1 mean unreachable and give no bound
+
+    Landmarks* landmarks = graph->landmarks;
+    unsigned long k = landmarks->nr_of_landmarks;
+    const float* from_a = landmarks->from_landmark+node_a_index*k;
+    const float* from_b = landmarks->from_landmark+node_b_index*k;
+    const float* to_a = landmarks->to_landmark+node_a_index*k;
+    const float* to_b = landmarks->to_landmark+node_b_index*k;
+    float bound = 0;
+
+    for (unsigned long l = 0; l<k; ++l) {
+        if (from_a[l]>=0 && from_b[l]>=0 && from_b[l]-from_a[l]>bound) bound = from_b[l]-from_a[l];
+        if (to_a[l]>=0 && to_b[l]>=0 && to_a[l]-to_b[l]>bound) bound = to_a[l]-to_b[l];
+    }
+    return bound;
+}
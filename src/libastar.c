@@ -0,0 +1,404 @@
+// libastar.c
+// the library interface of libastar.h on top of the graph, its side files and the query contexts
+
+
+#include "astar.h"
+
+struct AStarGraph {
+    Graph graph;
+    Landmarks landmarks; // only mapped if graph.landmarks points here
+    ContractionHierarchy hierarchy; // only mapped if graph.hierarchy points here
+    double load_milliseconds;
+};
+
+struct AStarQuery {
+    AStarGraph* graph;
+    SearchOptions options;
+    QueryContext context;
+    uint64_t* ids; // ids of the nodes of the last path, the context only has their indices
+    unsigned long capacity;
+    double milliseconds; // time of the last route
+    uint32_t* settled; // indices of the nodes reached by the last isochrone, room for all nodes
+    double* reach_distances; // distances of the nodes reached by the last isochrone
+    unsigned long reach_capacity;
+};
+
+static AStarCode parse_options(const AStarOptions* options, SearchOptions* search_options)
+{
+    // converts the option names into SearchOptions, a missing name keeps the default
+    search_options->algorithm = UNIDIRECTIONAL;
+    search_options->distance_method = HAVERSINE;
+    search_options->queue_type = DEFAULT_QUEUE;
+    if (options==NULL) return ASTAR_OK;
+    if (options->algorithm!=NULL && !parse_algorithm(options->algorithm, &search_options->algorithm))
+        return ASTAR_INVALID_OPTION;
+    if (options->heuristic!=NULL && !parse_heuristic(options->heuristic, &search_options->distance_method))
+        return ASTAR_INVALID_OPTION;
+    if (options->queue!=NULL && !parse_queue_type(options->queue, &search_options->queue_type))
+        return ASTAR_INVALID_OPTION;
+    // the equirectangular distance can exceed the edge lengths, the fscores are then not monotone, which the
+    // radix heap requires (the contraction hierarchy search uses no heuristic)
+    if (search_options->distance_method==EQUIRECTANGULAR && search_options->queue_type==RADIX_HEAP &&
+            search_options->algorithm!=CONTRACTION_HIERARCHY)
+        return ASTAR_INVALID_OPTION;
+    return ASTAR_OK;
+}
+
+static char* side_filename(const char* filename, const char* extension)
+{
+    // returns filename with its extension replaced (or extension appended if it has none),
+    // e.g. spain.alt for spain.bin, to be freed by the caller
+
+    const char* dot = strrchr(filename, '.');
+    const char* slash = strrchr(filename, '/');
+    size_t length = dot!=NULL && (slash==NULL || dot>slash) ? (size_t) (dot-filename) : strlen(filename);
+    char* name = malloc(length+strlen(extension)+1);
+
+    if (name==NULL) exit(1);
+    memcpy(name, filename, length);
+    strcpy(name+length, extension);
+    return name;
+}
+
+AStarCode astar_open(const char* filename, const AStarOptions* options, AStarGraph** graph)
+{
+    // the landmark tables are mapped for the landmark heuristic and the hierarchy for the ch algorithm,
+    // both are looked for next to the graph file
+    // *graph is NULL if the code is not ASTAR_OK
+
+    SearchOptions search_options;
+    AStarGraph* handle;
+    char* side;
+    AStarCode code;
+    struct timespec start, end;
+
+    *graph = NULL;
+    if ((code = parse_options(options, &search_options))!=ASTAR_OK) return code;
+    if ((handle = calloc(1, sizeof(AStarGraph)))==NULL) exit(1);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    code = read_binary_file(filename, &handle->graph);
+    if (code==ASTAR_OK && search_options.distance_method==LANDMARKS) {
+        side = side_filename(filename, ".alt");
+        code = read_landmark_file(side, &handle->graph, &handle->landmarks);
+        if (code==ASTAR_OK) handle->graph.landmarks = &handle->landmarks;
+        free(side);
+    }
+    if (code==ASTAR_OK && search_options.algorithm==CONTRACTION_HIERARCHY) {
+        side = side_filename(filename, ".ch");
+        code = read_hierarchy_file(side, &handle->graph, &handle->hierarchy);
+        if (code==ASTAR_OK) handle->graph.hierarchy = &handle->hierarchy;
+        free(side);
+    }
+    if (code!=ASTAR_OK) {
+        astar_close(handle);
+        return code;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    handle->load_milliseconds = elapsed_milliseconds(start, end);
+    *graph = handle;
+    return ASTAR_OK;
+}
+
+void astar_close(AStarGraph* graph)
+{
+    if (graph==NULL) return;
+    if (graph->graph.landmarks!=NULL) free_landmarks(&graph->landmarks);
+    if (graph->graph.hierarchy!=NULL) free_hierarchy(&graph->hierarchy);
+    free_graph(&graph->graph);
+    free(graph);
+}
+
+AStarCode astar_nearest_node(AStarGraph* graph, double lat, double lon, uint64_t* id, double* distance)
+{
+    unsigned long index = nearest_node(&graph->graph, lat, lon, distance);
+
+    if (index==ULONG_MAX) return ASTAR_UNKNOWN_NODE;
+    *id = graph->graph.ids[index];
+    return ASTAR_OK;
+}
+
+AStarCode astar_query_create(AStarGraph* graph, const AStarOptions* options, AStarQuery** query)
+{
+    // allocates the workspaces of the options once, the queries of the handle only reset them
+    // *query is NULL if the code is not ASTAR_OK
+
+    SearchOptions search_options;
+    AStarQuery* handle;
+    AStarCode code;
+
+    *query = NULL;
+    if ((code = parse_options(options, &search_options))!=ASTAR_OK) return code;
+    if (search_options.distance_method==LANDMARKS && graph->graph.landmarks==NULL) return ASTAR_NO_HEURISTIC;
+    if (search_options.algorithm==CONTRACTION_HIERARCHY && graph->graph.hierarchy==NULL) return ASTAR_NO_HIERARCHY;
+    if ((handle = calloc(1, sizeof(AStarQuery)))==NULL) exit(1);
+
+    handle->graph = graph;
+    handle->options = search_options;
+    init_query_context(&handle->context, &graph->graph, &handle->options);
+    *query = handle;
+    return ASTAR_OK;
+}
+
+void astar_query_free(AStarQuery* query)
+{
+    if (query==NULL) return;
+    free_query_context(&query->context);
+    free(query->ids);
+    free(query->settled);
+    free(query->reach_distances);
+    free(query);
+}
+
+AStarCode astar_route(AStarQuery* query, uint64_t source_id, uint64_t goal_id, AStarPath* path)
+{
+    // searches with the algorithm, heuristic and queue of the query
+    // path is empty (no nodes, length -1) if the code is not ASTAR_OK
+
+    Graph* graph = &query->graph->graph;
+    Path* found = &query->context.path;
+    unsigned long start_index, goal_index;
+    struct timespec start, end;
+    AStarCode code = ASTAR_OK;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    path->ids = NULL;
+    path->distances = NULL;
+    path->nr_of_nodes = 0;
+    path->length = -1;
+    start_index = get_node_by_id(graph, source_id);
+    goal_index = get_node_by_id(graph, goal_id);
+    if (start_index==ULONG_MAX || goal_index==ULONG_MAX) {
+        // nothing is searched, the statistics of the last route would be misleading
+        reset_workspace(&query->context.forward);
+        if (query->context.backward.status_list!=NULL) reset_workspace(&query->context.backward);
+        code = ASTAR_UNKNOWN_NODE;
+    }
+    else {
+        code = find_route(start_index, goal_index, graph, &query->options, &query->context);
+    }
+    if (code!=ASTAR_OK) {
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        query->milliseconds = elapsed_milliseconds(start, end);
+        return code;
+    }
+
+    if (found->nr_of_nodes>query->capacity) {
+        query->capacity = found->nr_of_nodes;
+        if ((query->ids = realloc(query->ids, query->capacity*sizeof(uint64_t)))==NULL) exit(1);
+    }
+    for (unsigned long i = 0; i<found->nr_of_nodes; ++i) {
+        query->ids[i] = graph->ids[found->indices[i]];
+    }
+    path->ids = query->ids;
+    path->distances = found->distances;
+    path->nr_of_nodes = found->nr_of_nodes;
+    path->length = found->length;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    query->milliseconds = elapsed_milliseconds(start, end);
+    return ASTAR_OK;
+}
+
+AStarCode astar_isochrone(AStarQuery* query, uint64_t depot_id, double max_distance, AStarReach* reach)
+{
+    // a Dijkstra search bounded by max_distance in the forward workspace, which every query has
+    // reach is empty if the code is not ASTAR_OK
+
+    Graph* graph = &query->graph->graph;
+    SearchWorkspace* workspace = &query->context.forward;
+    unsigned long depot_index;
+    unsigned long nr_of_reached_nodes;
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    reach->ids = NULL;
+    reach->distances = NULL;
+    reach->nr_of_nodes = 0;
+    if (query->context.backward.status_list!=NULL) reset_workspace(&query->context.backward);
+    if ((depot_index = get_node_by_id(graph, depot_id))==ULONG_MAX) {
+        reset_workspace(workspace);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        query->milliseconds = elapsed_milliseconds(start, end);
+        return ASTAR_UNKNOWN_NODE;
+    }
+    if (query->settled==NULL && (query->settled = malloc(graph->nr_of_nodes*sizeof(uint32_t)))==NULL) exit(1);
+
+    nr_of_reached_nodes = dijkstra(depot_index, graph, workspace, false, max_distance, query->settled);
+    if (nr_of_reached_nodes>query->capacity) {
+        query->capacity = nr_of_reached_nodes;
+        if ((query->ids = realloc(query->ids, query->capacity*sizeof(uint64_t)))==NULL) exit(1);
+    }
+    if (nr_of_reached_nodes>query->reach_capacity) {
+        query->reach_capacity = nr_of_reached_nodes;
+        query->reach_distances = realloc(query->reach_distances, query->reach_capacity*sizeof(double));
+        if (query->reach_distances==NULL) exit(1);
+    }
+    for (unsigned long i = 0; i<nr_of_reached_nodes; ++i) {
+        query->ids[i] = graph->ids[query->settled[i]];
+        query->reach_distances[i] = workspace->status_list[query->settled[i]].g;
+    }
+    reach->ids = query->ids;
+    reach->distances = query->reach_distances;
+    reach->nr_of_nodes = nr_of_reached_nodes;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    query->milliseconds = elapsed_milliseconds(start, end);
+    return ASTAR_OK;
+}
+
+AStarCode astar_distance_matrix(AStarGraph* graph, const AStarOptions* options, const uint64_t* source_ids,
+        size_t nr_of_sources, const uint64_t* target_ids, size_t nr_of_targets, unsigned int nr_of_threads,
+        double* distances)
+{
+    // looks up all ids before the searches, so an unknown id fails without computing anything
+
+    SearchOptions search_options;
+    uint32_t* sources;
+    uint32_t* targets;
+    unsigned long index;
+    AStarCode code;
+
+    if ((code = parse_options(options, &search_options))!=ASTAR_OK) return code;
+    sources = malloc((nr_of_sources+nr_of_targets+1)*sizeof(uint32_t));
+    if (sources==NULL) exit(1);
+    targets = sources+nr_of_sources;
+    for (size_t i = 0; i<nr_of_sources+nr_of_targets && code==ASTAR_OK; ++i) {
+        index = get_node_by_id(&graph->graph, i<nr_of_sources ? source_ids[i] : target_ids[i-nr_of_sources]);
+        if (index==ULONG_MAX) code = ASTAR_UNKNOWN_NODE;
+        sources[i] = (uint32_t) index;
+    }
+    if (code==ASTAR_OK) {
+        distance_matrix(&graph->graph, search_options.queue_type, sources, nr_of_sources, targets, nr_of_targets,
+                nr_of_threads, distances);
+    }
+    free(sources);
+    return code;
+}
+
+void astar_query_stats(AStarQuery* query, AStarStats* stats)
+{
+    // the counters come from the workspaces of the query context, see collect_stats
+    SearchStats counters;
+    struct rusage usage;
+
+    collect_stats(&query->context, &counters);
+    stats->milliseconds = query->milliseconds;
+    stats->settled_nodes = counters.settled_nodes;
+    stats->relaxed_edges = counters.relaxed_edges;
+    stats->pushes = counters.pushes;
+    stats->decrease_keys = counters.decrease_keys;
+    stats->pops = counters.pops;
+    stats->max_open_size = counters.max_open_size;
+    stats->reopened_nodes = counters.reopened_nodes;
+    stats->heuristic_evaluations = counters.heuristic_evaluations;
+    stats->load_milliseconds = query->graph->load_milliseconds;
+    stats->peak_memory_kb = getrusage(RUSAGE_SELF, &usage)==0 ? usage.ru_maxrss : -1;
+}
+
+int astar_format_stats(const AStarStats* stats, bool json, char* buffer, size_t size)
+{
+    if (json) {
+        return snprintf(buffer, size, "{\"milliseconds\":%.3f,\"settled_nodes\":%lu,\"relaxed_edges\":%lu,"
+                        "\"pushes\":%lu,\"decrease_keys\":%lu,\"pops\":%lu,\"max_open_size\":%lu,"
+                        "\"reopened_nodes\":%lu,\"heuristic_evaluations\":%lu,\"load_milliseconds\":%.3f,"
+                        "\"peak_memory_kb\":%ld}", stats->milliseconds, stats->settled_nodes, stats->relaxed_edges,
+                stats->pushes, stats->decrease_keys, stats->pops, stats->max_open_size, stats->reopened_nodes,
+                stats->heuristic_evaluations, stats->load_milliseconds, stats->peak_memory_kb);
+    }
+    return snprintf(buffer, size, "%.3f ms | settled %lu | relaxed %lu | pushes %lu | decrease-keys %lu | pops %lu | "
+                    "max OPEN %lu | reopened %lu | heuristic %lu | load %.3f ms | peak memory %ld kB",
+            stats->milliseconds, stats->settled_nodes, stats->relaxed_edges, stats->pushes, stats->decrease_keys,
+            stats->pops, stats->max_open_size, stats->reopened_nodes, stats->heuristic_evaluations,
+            stats->load_milliseconds, stats->peak_memory_kb);
+}
+
+AStarCode astar_convert(const char* csv_filename, unsigned int nr_of_threads, const char* node_order,
+        bool fixed_coordinates)
+{
+    // see read_csv_file and write_binary_file
+
+    Graph graph;
+    NodeOrder order = ID_ORDER;
+    char* bin_filename;
+    AStarCode code;
+
+    if (node_order!=NULL && !parse_node_order(node_order, &order)) return ASTAR_INVALID_OPTION;
+    if ((code = read_csv_file(csv_filename, &graph, nr_of_threads, order, fixed_coordinates))!=ASTAR_OK) return code;
+    bin_filename = side_filename(csv_filename, ".bin");
+    code = write_binary_file(bin_filename, &graph);
+    free(bin_filename);
+    free_graph(&graph);
+    return code;
+}
+
+AStarCode astar_build_landmarks(const char* filename, const AStarOptions* options, unsigned long nr_of_landmarks)
+{
+    // see build_landmarks and write_landmark_file
+
+    SearchOptions search_options;
+    Graph graph;
+    Landmarks landmarks;
+    char* alt_filename;
+    AStarCode code;
+
+    if ((code = parse_options(options, &search_options))!=ASTAR_OK) return code;
+    if ((code = read_binary_file(filename, &graph))!=ASTAR_OK) return code;
+    build_landmarks(&graph, nr_of_landmarks, search_options.queue_type, &landmarks);
+    alt_filename = side_filename(filename, ".alt");
+    code = write_landmark_file(alt_filename, &graph, &landmarks);
+    free(alt_filename);
+    free_landmarks(&landmarks);
+    free_graph(&graph);
+    return code;
+}
+
+AStarCode astar_contract(const char* filename, size_t* nr_of_shortcuts)
+{
+    // see build_contraction_hierarchy and write_hierarchy_file
+
+    Graph graph;
+    ContractionHierarchy hierarchy;
+    char* ch_filename;
+    unsigned long shortcuts;
+    AStarCode code;
+
+    if ((code = read_binary_file(filename, &graph))!=ASTAR_OK) return code;
+    shortcuts = build_contraction_hierarchy(&graph, &hierarchy);
+    if (nr_of_shortcuts!=NULL) *nr_of_shortcuts = shortcuts;
+    ch_filename = side_filename(filename, ".ch");
+    code = write_hierarchy_file(ch_filename, &graph, &hierarchy);
+    free(ch_filename);
+    free_hierarchy(&hierarchy);
+    free_graph(&graph);
+    return code;
+}
+
+const char* astar_code_message(AStarCode code)
+{
+    switch (code) {
+    case ASTAR_OK:
+        return "Success.";
+    case ASTAR_INVALID_OPTION:
+        return "Unknown option name. Algorithms: astar, bidirectional, ch. Heuristics: haversine, equirectangular, "
+               "landmarks. Queues: heap, list, radix. Node orders: id, hilbert, bfs. The equirectangular heuristic "
+               "does not work with the radix queue.";
+    case ASTAR_NO_ROUTE:
+        return "No solution found. The OPEN_LIST is empty.";
+    case ASTAR_UNKNOWN_NODE:
+        return "The source or the goal node id is not in the graph.";
+    case ASTAR_OPEN_ERROR:
+        return "A file could not be opened.";
+    case ASTAR_READ_ERROR:
+        return "A file could not be read. A .bin of another version or byte order has to be converted from the .csv "
+               "again, a .alt or .ch which was built for another graph or is damaged has to be built again.";
+    case ASTAR_WRITE_ERROR:
+        return "A file could not be written.";
+    case ASTAR_TOO_LARGE:
+        return "The graph has too many nodes or edges for the 32 bit indices.";
+    case ASTAR_NO_HEURISTIC:
+        return "The landmark heuristic needs the landmark tables, see -L.";
+    case ASTAR_NO_HIERARCHY:
+        return "The ch algorithm needs the contraction hierarchy, see -C.";
+    default:
+        return "Failure.";
+    }
+}
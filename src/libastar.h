@@ -0,0 +1,147 @@
+#ifndef ASTAR_LIBASTAR_H
+#define ASTAR_LIBASTAR_H
+
+// libastar: the router as a library, for embedding it in a long running service
+//
+// a graph is opened once and can then be shared read-only by any number of threads, every thread answers its
+// routing queries with its own query handle, so the graph stays resident and nothing is set up per query
+// no function of the library exits the process on a bad file, unknown ids or a missing route, they return a
+// status code instead (the exit codes of the command line tool); only an exhausted memory still ends it
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+// status codes of the library functions
+typedef int AStarCode;
+enum aStarCode {
+    ASTAR_OK = 0,
+    ASTAR_FAILURE = 1,
+    ASTAR_INVALID_OPTION = 2, // unknown algorithm, heuristic, queue or node order name, or equirectangular with radix
+    ASTAR_NO_ROUTE = 11, // the goal can not be reached from the source
+    ASTAR_UNKNOWN_NODE = 12, // the source or the goal id is not in the graph
+    ASTAR_OPEN_ERROR = 31, // a file can not be opened
+    ASTAR_READ_ERROR = 32, // a file is not a graph file of this version, was built for another graph or is damaged
+    ASTAR_WRITE_ERROR = 33, // a file can not be written
+    ASTAR_TOO_LARGE = 34, // a .csv has more nodes or edges than the 32 bit indices of the graph can hold
+    ASTAR_NO_HEURISTIC = 51, // landmark heuristic on a graph opened without its landmark tables
+    ASTAR_NO_HIERARCHY = 52 // contraction hierarchy search on a graph opened without its hierarchy
+};
+
+// a graph file with the side files the options of astar_open asked for
+typedef struct AStarGraph AStarGraph;
+
+// the search state of one thread, reused by all of its queries
+typedef struct AStarQuery AStarQuery;
+
+// the names of the command line options -a, -H and -q, a NULL name (or NULL options) selects the default
+typedef struct {
+    const char *algorithm; // astar (default), bidirectional or ch
+    const char *heuristic; // haversine (default), equirectangular or landmarks
+    const char *queue; // heap (default), list or radix
+} AStarOptions;
+
+// a route found by astar_route, it points into its query and is valid until the next route of that query
+typedef struct {
+    const uint64_t *ids; // node ids from the source to the goal
+    const double *distances; // distance of each node from the source in metres
+    size_t nr_of_nodes;
+    double length; // in metres
+} AStarPath;
+
+// the nodes reached by astar_isochrone, it points into its query and is valid until the next route of that query
+typedef struct {
+    const uint64_t *ids; // node ids by ascending distance, the depot first
+    const double *distances; // distance of each node from the depot in metres
+    size_t nr_of_nodes;
+} AStarReach;
+
+// the formats of astar_format_path and astar_write_path, all list the nodes from the source to the goal
+typedef int AStarPathFormat;
+enum aStarPathFormat {
+    ASTAR_PATH_TEXT = 0, // "Optimal Path found: " and a line "Node id:\t <id>\t| Distance:\t<metres>" per node
+    ASTAR_PATH_JSON = 1, // {"length":metres,"nr_of_nodes":n,"nodes":[ids],"distances":[metres]} and a line end
+    ASTAR_PATH_BINARY = 2 // "ASTARPT\0", then LEB128 varints: n, the length in cm and per node the zigzag encoded
+                          // differences of its id and of its distance in cm to the node before (to 0 for the first)
+};
+
+// counters and timers of the last route of a query, collected by every route at almost no cost
+typedef struct {
+    double milliseconds; // time of the route including the id lookup
+    unsigned long settled_nodes; // nodes taken from the OPEN set and closed
+    unsigned long relaxed_edges; // edges looked at from the settled nodes
+    unsigned long pushes, decrease_keys, pops; // operations on the OPEN set
+    unsigned long max_open_size; // largest OPEN set, of both directions together for bidirectional searches
+    unsigned long reopened_nodes; // CLOSED nodes put back into the OPEN set by a shorter path
+    unsigned long heuristic_evaluations;
+    double load_milliseconds; // time astar_open took for the graph
+    long peak_memory_kb; // peak resident memory of the process so far
+} AStarStats;
+
+
+// maps the graph file (e.g. spain.bin) and, if the options need them, spain.alt (-H landmarks) and spain.ch (-a ch)
+AStarCode astar_open(const char *filename, const AStarOptions *options, AStarGraph **graph);
+
+// releases a graph, all of its queries have to be freed before
+void astar_close(AStarGraph *graph);
+
+// creates the search state for routing on graph with the given options
+AStarCode astar_query_create(AStarGraph *graph, const AStarOptions *options, AStarQuery **query);
+
+void astar_query_free(AStarQuery *query);
+
+// finds the id of the routable node (a node with an edge) closest to a latitude and longitude in degrees,
+// e.g. to route between coordinates, and its air distance in metres; a grid stored in the graph file is searched
+// around the coordinates, so a lookup takes microseconds
+// returns ASTAR_UNKNOWN_NODE if the graph has no routable node
+AStarCode astar_nearest_node(AStarGraph *graph, double lat, double lon, uint64_t *id, double *distance);
+
+// finds a shortest route between two node ids
+AStarCode astar_route(AStarQuery *query, uint64_t source_id, uint64_t goal_id, AStarPath *path);
+
+// finds all nodes within max_distance metres of the depot (a service area), with the queue of the query
+// counts as a route of the query for astar_query_stats
+AStarCode astar_isochrone(AStarQuery *query, uint64_t depot_id, double max_distance, AStarReach *reach);
+
+// the statistics of the last route of the query
+void astar_query_stats(AStarQuery *query, AStarStats *stats);
+
+// writes the statistics into buffer as one line of text or as a JSON object, both without a line end
+// returns the length like snprintf
+int astar_format_stats(const AStarStats *stats, bool json, char *buffer, size_t size);
+
+// formats a route into buffer without any stdio call per node, the distances are rounded to centimetres
+// returns the length of the whole output like snprintf, it is cut off at size bytes and the text formats are
+// terminated like by snprintf, so a buffer is large enough if the length is less than size
+size_t astar_format_path(const AStarPath *path, AStarPathFormat format, char *buffer, size_t size);
+
+// writes a route to a file, or to stdout for a NULL or "-" filename, in blocks of 64 KiB
+AStarCode astar_write_path(const AStarPath *path, AStarPathFormat format, const char *filename);
+
+// computes the distances in metres from every source to every target with nr_of_threads threads, e.g. the
+// travel distances of a dispatch problem, much faster than a route per pair: one search per source which stops
+// as soon as all targets are reached
+// distances has nr_of_sources rows of nr_of_targets, -1 for a target which can not be reached from its source
+// only the queue of the options is used
+AStarCode astar_distance_matrix(AStarGraph *graph, const AStarOptions *options, const uint64_t *source_ids,
+                                size_t nr_of_sources, const uint64_t *target_ids, size_t nr_of_targets,
+                                unsigned int nr_of_threads, double *distances);
+
+// converts a .csv into a graph file next to it (spain.bin for spain.csv) with nr_of_threads threads
+// node_order is the name of -O (id, hilbert or bfs, NULL for id), fixed_coordinates is -F
+AStarCode astar_convert(const char *csv_filename, unsigned int nr_of_threads, const char *node_order,
+                        bool fixed_coordinates);
+
+// chooses nr_of_landmarks landmarks and writes their distance tables next to the graph file (spain.alt),
+// the queue of the options is used for the Dijkstra searches
+AStarCode astar_build_landmarks(const char *filename, const AStarOptions *options, unsigned long nr_of_landmarks);
+
+// contracts the graph and writes the contraction hierarchy next to the graph file (spain.ch),
+// sets nr_of_shortcuts to the number of shortcuts of the hierarchy unless it is NULL
+AStarCode astar_contract(const char *filename, size_t *nr_of_shortcuts);
+
+// a one line description of a status code
+const char *astar_code_message(AStarCode code);
+
+#endif //ASTAR_LIBASTAR_H
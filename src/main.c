@@ -0,0 +1,311 @@
+// main.c
+// command line interface of the router, a thin client of the library interface in libastar.h
+
+
+#include "astar.h"
+
+static void print_stats(AStarQuery* query, StatsOutput stats_output)
+{
+    // the statistics of the last route go to stderr, so they never mix with the results
+    AStarStats stats;
+    char line[STATS_LINE_SIZE];
+
+    if (stats_output==NO_STATS) return;
+    astar_query_stats(query, &stats);
+    astar_format_stats(&stats, stats_output==JSON_STATS, line, sizeof(line));
+    fprintf(stderr, "%s\n", line);
+}
+
+static AStarCode resolve_node(AStarGraph* graph, const char* argument, unsigned long* id, FILE* messages)
+{
+    // a source or goal argument is a node id or "lat,lon" in degrees, which stands for the closest routable node
+    // the node found is reported to messages
+    double lat, lon, distance;
+    uint64_t nearest;
+    AStarCode code;
+
+    if (strchr(argument, ',')==NULL) {
+        *id = strtoul(argument, NULL, 10);
+        return ASTAR_OK;
+    }
+    if (sscanf(argument, "%lf,%lf", &lat, &lon)!=2) return ASTAR_FAILURE;
+    if ((code = astar_nearest_node(graph, lat, lon, &nearest, &distance))!=ASTAR_OK) return code;
+    fprintf(messages, "Nearest node of %s is %lu, %.2f m away.\n", argument, (unsigned long) nearest, distance);
+    *id = nearest;
+    return ASTAR_OK;
+}
+
+static bool replace_extension(const char* filename, const char* extension, char* name, size_t size)
+{
+    // writes filename with the extension after its last '.' replaced into name, e.g. spain.alt for spain.bin
+    // returns false if that does not fit into size bytes
+
+    int length = snprintf(name, size, "%.*s%s", (int) (strrchr(filename, '.')-filename), filename, extension);
+    return length>=0 && (size_t) length<size;
+}
+
+static int fail(AStarCode code)
+{
+    // reports a failed library call, its code is the exit code
+    fprintf(stderr, "%s\n", astar_code_message(code));
+    return code;
+}
+
+int main(int argc, char* argv[])
+{
+    // depending on how the input file (only parameter) is named it will read a file and run the astar algorithm
+    //
+    // if file is named *.csv it will read the csv file and construct the graph (i.e. node list)
+    // and then write this information to a binary file for faster reading at a later stage
+    //
+    // if the file is named *.bin it will read the binary, construct the graph and run the A* algorithm
+    //
+    // usage:   ./astar [-t threads] [-O id|hilbert|bfs] [-F] /path/to/my/file.csv  OR
+    //          ./astar [-a astar|bidirectional|ch] [-q heap|list|radix] [-s text|json] [-f text|json|binary]
+    //                  [-o file|-] /path/to/my/file.bin [source_node_id|lat,lon goal_node_id|lat,lon]  OR
+    //          ./astar [-a ...] [-q ...] [-s ...] [-t threads] [-V] -b queries.txt /path/to/my/file.bin  OR
+    //          ./astar [-a ...] [-q ...] [-s ...] [-t threads] -S /path/to/socket|port /path/to/my/file.bin  OR
+    //          ./astar [-q ...] [-t threads] [-f csv|binary] -M sources.txt [-T targets.txt] /path/to/my/file.bin  OR
+    //          ./astar [-q ...] [-t threads] [-f csv|binary] -I depots.txt [-D metres] /path/to/my/file.bin  OR
+    //          ./astar -L nr_of_landmarks /path/to/my/file.bin  OR
+    //          ./astar -C /path/to/my/file.bin
+    //
+    // -a selects the search algorithm, unidirectional A* is the default
+    // -q selects the OPEN set implementation, the d-ary heap is the default
+    // -b answers all source/goal pairs of a file ('-' for stdin) against the loaded graph, see run_batch
+    // -M computes the distances from the ids of sources.txt to the ones of -T targets.txt (the sources without -T),
+    //    the matrix is written to stdout as csv or with -f binary, see run_matrix
+    // -I finds the nodes within -D metres (all reachable nodes without -D) of every depot of depots.txt,
+    //    written to stdout as csv or with -f binary, see run_isochrones
+    // -f selects the format of a route: text (default), json or binary, see AStarPathFormat in libastar.h
+    // -o writes a route to file ('-' for stdout, then the messages go to stderr), file.out next to the graph
+    //    without -o
+    // -S serves routes to local clients over a unix domain socket or a TCP port on localhost, see server.c
+    // -t sets the number of worker threads for -b, -M, -I, -S and for reading a .csv
+    // -V checks every answer of -b against the unidirectional A*
+    // -s prints the search statistics of every route (settled nodes, queue operations, time, ...) to stderr,
+    //    as a line of text or of JSON, the server adds them to its answers instead
+    // -H selects the heuristic: haversine (default), equirectangular or landmarks
+    // -L chooses landmarks and writes their distance tables to file.alt, needed for -H landmarks
+    // -O renumbers the nodes of a converted graph for memory locality, see reorder_graph
+    // -F stores the coordinates of a converted graph as fixed-point numbers, see to_fixed_coordinates
+    // -C contracts the graph and writes the contraction hierarchy to file.ch, needed for -a ch
+
+    char* filename;
+    char* extension;
+    char landmark_filename[PATH_MAX];
+    char hierarchy_filename[PATH_MAX];
+    char path_filename[PATH_MAX];
+    char* output_filename = NULL;
+    FILE* messages = stdout;
+    unsigned long nr_of_landmarks = 0;
+    bool contract = false;
+    size_t nr_of_shortcuts;
+    bool binary = false; // switch for reading a .csv or a .bin file, depends on the line ending
+
+    // the names of -a, -H and -q, NULL keeps the default of the library
+    AStarOptions options = {.algorithm=NULL, .heuristic=NULL, .queue=NULL};
+    bool verify = false;
+    char* queries_filename = NULL;
+    char* server_address = NULL;
+    char* sources_filename = NULL;
+    char* targets_filename = NULL;
+    char* depots_filename = NULL;
+    double max_distance = DBL_MAX;
+    char* end;
+    OutputFormat output_format = TEXT_OUTPUT;
+    unsigned int nr_of_threads = 1;
+    char* node_order = NULL;
+    bool fixed_coordinates = false;
+    StatsOutput stats_output = NO_STATS;
+    int option;
+    AStarGraph* graph;
+    AStarQuery* query;
+    AStarPath path;
+    AStarCode code;
+    unsigned long node_start = 240949599; //default start node id for the spain.csv
+    unsigned long node_goal = 195977239; //default end node id for the spain.csv
+    char* start_argument = NULL; // node id or coordinates, resolved once the graph is loaded
+    char* goal_argument = NULL;
+
+    //parse command line options
+    while ((option = getopt(argc, argv, "a:q:b:t:VH:L:CO:FS:s:M:T:f:o:I:D:"))!=-1) {
+        switch (option) {
+        case 'a':
+            options.algorithm = optarg;
+            break;
+        case 'q':
+            options.queue = optarg;
+            break;
+        case 'b':
+            queries_filename = optarg;
+            break;
+        case 't':
+            nr_of_threads = (unsigned int) strtoul(optarg, NULL, 10);
+            if (nr_of_threads==0) nr_of_threads = 1;
+            break;
+        case 'V':
+            verify = true;
+            break;
+        case 'H':
+            options.heuristic = optarg;
+            break;
+        case 'L':
+            nr_of_landmarks = strtoul(optarg, NULL, 10);
+            if (nr_of_landmarks==0) nr_of_landmarks = DEFAULT_LANDMARKS;
+            break;
+        case 'C':
+            contract = true;
+            break;
+        case 'O':
+            node_order = optarg;
+            break;
+        case 'F':
+            fixed_coordinates = true;
+            break;
+        case 'S':
+            server_address = optarg;
+            break;
+        case 's':
+            if (strcmp(optarg, "text")==0) stats_output = TEXT_STATS;
+            else if (strcmp(optarg, "json")==0) stats_output = JSON_STATS;
+            else return fail(ASTAR_INVALID_OPTION);
+            break;
+        case 'M':
+            sources_filename = optarg;
+            break;
+        case 'T':
+            targets_filename = optarg;
+            break;
+        case 'I':
+            depots_filename = optarg;
+            break;
+        case 'D':
+            // a distance in metres, a typo must not silently become an isochrone of 0 m or of the whole graph
+            // inf, nan and overflows are kept out by their letters and errno, -Ofast lets the compiler assume
+            // that isfinite always holds
+            errno = 0;
+            max_distance = strtod(optarg, &end);
+            if (end==optarg || *end!='\0' || optarg[strspn(optarg, "0123456789.eE+-")]!='\0' || errno==ERANGE ||
+                    max_distance<=0) {
+                fprintf(stderr, "-D needs a positive distance in metres.\n");
+                return ASTAR_INVALID_OPTION;
+            }
+            break;
+        case 'f':
+            if (strcmp(optarg, "csv")==0 || strcmp(optarg, "text")==0) output_format = TEXT_OUTPUT;
+            else if (strcmp(optarg, "json")==0) output_format = JSON_OUTPUT;
+            else if (strcmp(optarg, "binary")==0) output_format = BINARY_OUTPUT;
+            else return fail(ASTAR_INVALID_OPTION);
+            break;
+        case 'o':
+            output_filename = optarg;
+            break;
+        default:
+            exit(1);
+        }
+    }
+
+    //parse command line arguments
+    if (argc-optind<1) {
+        printf("Please specify at least a .csv for parsing or a .bin for computing a route.\nUsage: ./astar spain.csv");
+        exit(1);
+    }
+    else {
+        //set filename
+        filename = argv[optind];
+        if (argc-optind==3) {
+            //set source and destination, ignored if a .csv file is read
+            start_argument = argv[optind+1];
+            goal_argument = argv[optind+2];
+        }
+    }
+
+
+    //check if binary file or not (otherwise a csv file is assumed)
+    // the side files and the route are named after the graph by its extension, so it has to have one
+    extension = strrchr(filename, '.');
+    if (extension==NULL || strchr(extension, '/')!=NULL) {
+        printf("Please specify a file with an extension, .csv for parsing or .bin for computing a route.\n");
+        exit(1);
+    }
+    if (strcmp(extension, ".bin")==0) {
+        binary = true;
+    }
+
+    //read either a .csv file and create a binary file
+    // or read a binary file and compute a route
+    if (binary==false) {
+        if ((code = astar_convert(filename, nr_of_threads, node_order, fixed_coordinates))!=ASTAR_OK) return fail(code);
+        return 0;
+    }
+
+    // the landmark tables live next to the graph, e.g. spain.alt for spain.bin
+    if (!replace_extension(filename, ".alt", landmark_filename, sizeof(landmark_filename)) ||
+            !replace_extension(filename, ".ch", hierarchy_filename, sizeof(hierarchy_filename))) {
+        return fail(ASTAR_OPEN_ERROR);
+    }
+    if (nr_of_landmarks>0) {
+        if ((code = astar_build_landmarks(filename, &options, nr_of_landmarks))!=ASTAR_OK) return fail(code);
+        printf("Landmarks are written to %s\n", landmark_filename);
+        return 0;
+    }
+    if (contract) {
+        if ((code = astar_contract(filename, &nr_of_shortcuts))!=ASTAR_OK) return fail(code);
+        printf("Contraction hierarchy with %lu shortcuts is written to %s\n", (unsigned long) nr_of_shortcuts,
+                hierarchy_filename);
+        return 0;
+    }
+
+    // the distance matrix and the isochrones are csv or binary
+    if ((depots_filename!=NULL || sources_filename!=NULL) && output_format==JSON_OUTPUT) {
+        return fail(ASTAR_INVALID_OPTION);
+    }
+    // a route goes to file.out next to the graph unless -o names another file
+    if (output_filename==NULL) {
+        if (!replace_extension(filename, ".out", path_filename, sizeof(path_filename))) return fail(ASTAR_OPEN_ERROR);
+        output_filename = path_filename;
+    }
+    if (strcmp(output_filename, "-")==0) messages = stderr;
+
+    if ((code = astar_open(filename, &options, &graph))!=ASTAR_OK) return fail(code);
+    if (server_address!=NULL) {
+        code = run_server(server_address, graph, &options, nr_of_threads, stats_output);
+        if (code!=ASTAR_OK && code!=ASTAR_FAILURE) fail(code); // a socket error is reported by run_server
+    }
+    else if (depots_filename!=NULL) {
+        code = run_isochrones(depots_filename, max_distance, graph, &options, nr_of_threads, output_format);
+        if (code!=ASTAR_OK) fail(code);
+    }
+    else if (sources_filename!=NULL) {
+        code = run_matrix(sources_filename, targets_filename, graph, &options, nr_of_threads, output_format);
+        if (code!=ASTAR_OK) fail(code);
+    }
+    else if (queries_filename!=NULL) {
+        code = run_batch(queries_filename, graph, &options, nr_of_threads, verify, stats_output);
+        if (code!=ASTAR_OK && code!=ASTAR_FAILURE) fail(code); // the mismatches are reported by run_batch
+    }
+    else if ((code = astar_query_create(graph, &options, &query))!=ASTAR_OK) {
+        fail(code);
+    }
+    else {
+        if (start_argument!=NULL && (code = resolve_node(graph, start_argument, &node_start, messages))==ASTAR_OK) {
+            code = resolve_node(graph, goal_argument, &node_goal, messages);
+        }
+        if (code==ASTAR_OK) code = astar_route(query, node_start, node_goal, &path);
+        if (code==ASTAR_OK) {
+            fprintf(messages, "Solution found. With length of %f.\n", path.length);
+            code = astar_write_path(&path, output_format==JSON_OUTPUT ? ASTAR_PATH_JSON :
+                    output_format==BINARY_OUTPUT ? ASTAR_PATH_BINARY : ASTAR_PATH_TEXT, output_filename);
+            if (code!=ASTAR_OK) fail(code);
+            else if (messages==stdout) printf("Optimal Path is written to %s", output_filename);
+        }
+        else {
+            fail(code);
+        }
+        print_stats(query, stats_output);
+        astar_query_free(query);
+    }
+    astar_close(graph);
+    return code;
+}
@@ -0,0 +1,116 @@
+// matrix.c
+// computes the distances between lists of source and target nodes against one loaded graph
+// part of the command line tool, it only uses the library interface of libastar.h
+
+
+#include "astar.h"
+
+uint64_t* read_ids(char* filename, unsigned long* nr_of_ids)
+{
+    // reads node ids from filename (one per line, '-' for stdin), empty lines and lines starting with # are skipped
+    // returns the ids and sets nr_of_ids, or NULL if the file can not be opened
+
+    FILE* fin;
+    char* buffer = NULL;
+    size_t characters = 0;
+    unsigned long id;
+    unsigned long capacity = 1024;
+    uint64_t* ids = malloc(capacity*sizeof(uint64_t));
+
+    if (ids==NULL) exit(1);
+    if (strcmp(filename, "-")==0) {
+        fin = stdin;
+    }
+    else if ((fin = fopen(filename, "r"))==NULL) {
+        free(ids);
+        return NULL;
+    }
+
+    *nr_of_ids = 0;
+    while (getline(&buffer, &characters, fin)!=-1) {
+        if (buffer[0]=='#' || sscanf(buffer, "%lu", &id)!=1) continue;
+        if (*nr_of_ids==capacity) {
+            capacity *= 2;
+            if ((ids = realloc(ids, capacity*sizeof(uint64_t)))==NULL) exit(1);
+        }
+        ids[(*nr_of_ids)++] = id;
+    }
+
+    free(buffer);
+    if (fin!=stdin) fclose(fin);
+    return ids;
+}
+
+static void write_csv_matrix(FILE* fout, uint64_t* sources, unsigned long nr_of_sources, uint64_t* targets,
+        unsigned long nr_of_targets, double* distances)
+{
+    // a header line with the target ids, then one line per source starting with its id, distances in metres
+    fputs("source", fout);
+    for (unsigned long j = 0; j<nr_of_targets; ++j) fprintf(fout, ",%lu", (unsigned long) targets[j]);
+    fputc('\n', fout);
+    for (unsigned long i = 0; i<nr_of_sources; ++i) {
+        fprintf(fout, "%lu", (unsigned long) sources[i]);
+        for (unsigned long j = 0; j<nr_of_targets; ++j) fprintf(fout, ",%.2f", distances[i*nr_of_targets+j]);
+        fputc('\n', fout);
+    }
+}
+
+static void write_binary_matrix(FILE* fout, uint64_t* sources, unsigned long nr_of_sources, uint64_t* targets,
+        unsigned long nr_of_targets, double* distances)
+{
+    // MATRIX_MAGIC, the numbers of sources and targets as uint64, the source ids, the target ids and the
+    // distances as doubles row by row, all in native byte order
+    uint64_t sizes[2] = {nr_of_sources, nr_of_targets};
+
+    fwrite(MATRIX_MAGIC, 1, 8, fout);
+    fwrite(sizes, sizeof(uint64_t), 2, fout);
+    fwrite(sources, sizeof(uint64_t), nr_of_sources, fout);
+    fwrite(targets, sizeof(uint64_t), nr_of_targets, fout);
+    fwrite(distances, sizeof(double), nr_of_sources*nr_of_targets, fout);
+}
+
+AStarCode run_matrix(char* sources_filename, char* targets_filename, AStarGraph* graph, const AStarOptions* options,
+        unsigned int nr_of_threads, OutputFormat format)
+{
+    // computes the distances from the ids of sources_filename to the ones of targets_filename (see read_ids,
+    // the sources again if it is NULL) and writes the matrix to stdout as csv or binary (see the writers above)
+    // -1 stands for a target which can not be reached, the time goes to stderr
+    // returns the code of astar_distance_matrix, ASTAR_OPEN_ERROR if an id file can not be read or ASTAR_WRITE_ERROR
+
+    uint64_t* sources;
+    uint64_t* targets;
+    unsigned long nr_of_sources, nr_of_targets;
+    double* distances;
+    struct timespec start, end;
+    AStarCode code;
+
+    if ((sources = read_ids(sources_filename, &nr_of_sources))==NULL) return ASTAR_OPEN_ERROR;
+    targets = targets_filename!=NULL ? read_ids(targets_filename, &nr_of_targets) : sources;
+    if (targets==NULL) {
+        free(sources);
+        return ASTAR_OPEN_ERROR;
+    }
+    if (targets_filename==NULL) nr_of_targets = nr_of_sources;
+    if ((distances = malloc((nr_of_sources*nr_of_targets+1)*sizeof(double)))==NULL) exit(1);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    code = astar_distance_matrix(graph, options, sources, nr_of_sources, targets, nr_of_targets, nr_of_threads,
+            distances);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (code==ASTAR_OK) {
+        fprintf(stderr, "Computed %lu x %lu distances in %.3f ms with %u thread(s).\n", nr_of_sources, nr_of_targets,
+                elapsed_milliseconds(start, end), nr_of_threads);
+        if (format==BINARY_OUTPUT) {
+            write_binary_matrix(stdout, sources, nr_of_sources, targets, nr_of_targets, distances);
+        }
+        else {
+            write_csv_matrix(stdout, sources, nr_of_sources, targets, nr_of_targets, distances);
+        }
+        if (fflush(stdout)!=0 || ferror(stdout)) code = ASTAR_WRITE_ERROR;
+    }
+
+    free(distances);
+    if (targets!=sources) free(targets);
+    free(sources);
+    return code;
+}
@@ -0,0 +1,161 @@
+// output.c
+// writes found paths as text, JSON or compact binary into a caller's buffer, a file or stdout
+// the numbers are formatted by hand into a buffer which is written in large blocks, there is no stdio call per node
+
+
+#include "astar.h"
+
+static void put_bytes(PathWriter* writer, const void* data, size_t length)
+{
+    // appends to the buffer, a full buffer is written to the file or, without a file, only counted
+    const char* bytes = data;
+    size_t part;
+
+    writer->total += length;
+    while (length>0) {
+        if (writer->used==writer->size) {
+            if (writer->file==NULL) return;
+            if (fwrite(writer->buffer, 1, writer->used, writer->file)!=writer->used) writer->failed = true;
+            writer->used = 0;
+        }
+        part = writer->size-writer->used<length ? writer->size-writer->used : length;
+        memcpy(writer->buffer+writer->used, bytes, part);
+        writer->used += part;
+        bytes += part;
+        length -= part;
+    }
+}
+
+static void put_text(PathWriter* writer, const char* text)
+{
+    put_bytes(writer, text, strlen(text));
+}
+
+static void put_unsigned(PathWriter* writer, uint64_t value)
+{
+    // decimal digits, the largest uint64 has 20
+    char digits[20];
+    int position = 20;
+
+    do {
+        digits[--position] = (char) ('0'+value%10);
+        value /= 10;
+    } while (value>0);
+    put_bytes(writer, digits+position, (size_t) (20-position));
+}
+
+static void put_metres(PathWriter* writer, double metres)
+{
+    // a distance with two decimals like %.2f
+    long long centimetres = llround(metres*100);
+    char decimals[3];
+
+    if (centimetres<0) {
+        put_bytes(writer, "-", 1);
+        centimetres = -centimetres;
+    }
+    put_unsigned(writer, (uint64_t) centimetres/100);
+    decimals[0] = '.';
+    decimals[1] = (char) ('0'+centimetres/10%10);
+    decimals[2] = (char) ('0'+centimetres%10);
+    put_bytes(writer, decimals, 3);
+}
+
+static void put_varint(PathWriter* writer, uint64_t value)
+{
+    // LEB128: 7 bits per byte starting with the lowest, the high bit is set on all bytes but the last
+    unsigned char bytes[10];
+    size_t length = 0;
+
+    while (value>=0x80) {
+        bytes[length++] = (unsigned char) (value | 0x80);
+        value >>= 7;
+    }
+    bytes[length++] = (unsigned char) value;
+    put_bytes(writer, bytes, length);
+}
+
+static uint64_t zigzag(int64_t value)
+{
+    // maps signed deltas to unsigned ones with small magnitudes staying small: 0, -1, 1, -2, ... to 0, 1, 2, 3, ...
+    return ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+}
+
+static void put_path(PathWriter* writer, const AStarPath* path, AStarPathFormat format)
+{
+    // the formats are described at AStarPathFormat in libastar.h, consecutive nodes of a route are close in id and
+    // distance, so the differences of the binary format mostly take a few bytes
+
+    int64_t previous_id = 0, previous_centimetres = 0, centimetres;
+
+    if (format==ASTAR_PATH_BINARY) {
+        put_bytes(writer, PATH_MAGIC, 8);
+        put_varint(writer, path->nr_of_nodes);
+        put_varint(writer, (uint64_t) llround(fmax(path->length, 0)*100));
+        for (size_t i = 0; i<path->nr_of_nodes; ++i) {
+            centimetres = llround(path->distances[i]*100);
+            put_varint(writer, zigzag((int64_t) path->ids[i]-previous_id));
+            put_varint(writer, zigzag(centimetres-previous_centimetres));
+            previous_id = (int64_t) path->ids[i];
+            previous_centimetres = centimetres;
+        }
+    }
+    else if (format==ASTAR_PATH_JSON) {
+        put_text(writer, "{\"length\":");
+        put_metres(writer, path->length);
+        put_text(writer, ",\"nr_of_nodes\":");
+        put_unsigned(writer, path->nr_of_nodes);
+        put_text(writer, ",\"nodes\":[");
+        for (size_t i = 0; i<path->nr_of_nodes; ++i) {
+            if (i>0) put_bytes(writer, ",", 1);
+            put_unsigned(writer, path->ids[i]);
+        }
+        put_text(writer, "],\"distances\":[");
+        for (size_t i = 0; i<path->nr_of_nodes; ++i) {
+            if (i>0) put_bytes(writer, ",", 1);
+            put_metres(writer, path->distances[i]);
+        }
+        put_text(writer, "]}\n");
+    }
+    else {
+        put_text(writer, "Optimal Path found: \n");
+        for (size_t i = 0; i<path->nr_of_nodes; ++i) {
+            put_text(writer, "Node id:\t ");
+            put_unsigned(writer, path->ids[i]);
+            put_text(writer, "\t| Distance:\t");
+            put_metres(writer, path->distances[i]);
+            put_bytes(writer, "\n", 1);
+        }
+    }
+}
+
+size_t astar_format_path(const AStarPath* path, AStarPathFormat format, char* buffer, size_t size)
+{
+    // the output is cut off at size bytes, like snprintf the text formats are always terminated
+    PathWriter writer = {.buffer=buffer, .size=size, .used=0, .total=0, .file=NULL, .failed=false};
+
+    put_path(&writer, path, format);
+    if (format!=ASTAR_PATH_BINARY && size>0) buffer[writer.total<size ? writer.total : size-1] = '\0';
+    return writer.total;
+}
+
+AStarCode astar_write_path(const AStarPath* path, AStarPathFormat format, const char* filename)
+{
+    // formats into a block of PATH_BUFFER_SIZE bytes which is written whenever it is full
+    char buffer[PATH_BUFFER_SIZE];
+    PathWriter writer = {.buffer=buffer, .size=sizeof(buffer), .used=0, .total=0, .failed=false};
+    bool standard_output = filename==NULL || strcmp(filename, "-")==0;
+
+    if (standard_output) writer.file = stdout;
+    else if ((writer.file = fopen(filename, format==ASTAR_PATH_BINARY ? "wb" : "w"))==NULL) return ASTAR_OPEN_ERROR;
+
+    put_path(&writer, path, format);
+    if (fwrite(writer.buffer, 1, writer.used, writer.file)!=writer.used) writer.failed = true;
+    if (standard_output) {
+        if (fflush(stdout)!=0) writer.failed = true;
+    }
+    else if (fclose(writer.file)!=0) {
+        writer.failed = true;
+    }
+    return writer.failed ? ASTAR_WRITE_ERROR : ASTAR_OK;
+}
@@ -0,0 +1,36 @@
+// parallel.c
+// the thread pool used by the .csv conversion and the batch mode, and the timing of the benchmarks
+
+
+#include "astar.h"
+
+double elapsed_milliseconds(struct timespec start, struct timespec end)
+{
+    // returns the time between two clock_gettime calls in milliseconds
+    return (end.tv_sec-start.tv_sec)*1e3+(end.tv_nsec-start.tv_nsec)*1e-6;
+}
+
+void run_parallel(unsigned int nr_of_threads, void* (* worker)(void*), void* context)
+{
+    // runs worker(context) on nr_of_threads threads and waits for all of them
+    // the workers share the context and have to split the work themselves, e.g. with an atomic cursor
+    // a single thread runs on the calling thread, and so does one more worker if not all threads can be created,
+    // it takes what the others leave, so the work is done with fewer threads instead of not at all
+
+    pthread_t* threads;
+    unsigned int nr_of_created = 0;
+
+    if (nr_of_threads<=1) {
+        worker(context);
+        return;
+    }
+    if ((threads = malloc(nr_of_threads*sizeof(pthread_t)))==NULL) exit(1);
+    while (nr_of_created<nr_of_threads && pthread_create(&threads[nr_of_created], NULL, worker, context)==0) {
+        nr_of_created++;
+    }
+    if (nr_of_created<nr_of_threads) worker(context);
+    for (unsigned int i = 0; i<nr_of_created; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+}
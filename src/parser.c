@@ -1,315 +1,698 @@
 // parser.c
-// contains general .csv parsing functionality for building the graph, i.e. nodes array
+// contains general .csv parsing functionality for building the graph, i.e. the CSR arrays of the Graph
 
 
 #include "astar.h"
 
 
-unsigned long get_nr_of_nodes(char *filename) {
-    // returns number of nodes
-    // assumes the first three #lines and that there are now ways or relation line between nodes
-    // i.e. if it does not read a node anymore it will finish completely.
-
-    unsigned long nr_of_nodes = 0;
-    char *buffer;
-    size_t characters = 0;
-
-
-    FILE *fp = fopen(filename, "r");
-    buffer = (char *) malloc(characters * sizeof(char));
-
-    //skip the first three lines
-    characters = (size_t) getline(&buffer, &characters, fp);
-    characters = (size_t) getline(&buffer, &characters, fp);
-    characters = (size_t) getline(&buffer, &characters, fp);
+static const char *next_field(const char *position, const char *line_end) {
+    // returns the start of the field after the one at position or line_end if it is the last field
+    const char *separator = memchr(position, '|', (size_t) (line_end - position));
+    return separator == NULL ? line_end : separator + 1;
+}
 
+static uint64_t parse_unsigned(const char *position, const char *line_end) {
+    // parses the decimal digits at position, stops at the first other character
+    // returns 0 if there are no digits, like strtoul did before
+    uint64_t value = 0;
 
-    // count number of nodes for array initialization
-    while ((characters = (size_t) getline(&buffer, &characters, fp)) > 0) {
-        if (buffer[0] == 'n') {
-            nr_of_nodes++;
-        } else {
-            // break when not reading any more nodes
-            break;
-        }
+    while (position < line_end && *position >= '0' && *position <= '9') {
+        value = value * 10 + (uint64_t) (*position - '0');
+        position++;
     }
-    fclose(fp);
-    return nr_of_nodes;
+    return value;
 }
 
-void get_nodes(char *filename, node **nodes, unsigned long nr_of_nodes) {
-    // returns the complete nodes array with all nodes and edges
-    // first reads all the node lines
-    // the array will be initialized by a length of nr_of_nodes which is computed (read) before
-    // secondly it will read the 'way' lines
-    // as first step it will only parse how many neighbours each node has
-    // this is done in get_edges with the parameters nsucc_only=true
-    // in a later step get_edges will be called with nsucc_only=false and a current neighbour number list
-    // and then build the real edges
-    const char delimiters[] = "|";
-    char *buffer;
-    size_t characters = 0;
-    FILE *fp = fopen(filename, "r");
-
-    *nodes = malloc(nr_of_nodes * sizeof(node));
-    buffer = (char *) malloc(characters * sizeof(char));
-
-    //skip the first three lines of the file because they start with #
-    characters = (size_t) getline(&buffer, &characters, fp);
-    characters = (size_t) getline(&buffer, &characters, fp);
-    characters = (size_t) getline(&buffer, &characters, fp);
-
-    unsigned long id;
-    double lon;
-    double lat;
-
-    // counter to get the current position in the nodes array
-    int counter = 0;
-
-    while ((characters = (size_t) getline(&buffer, &characters, fp)) > 0) {
-        if (buffer[0] == 'n') {
-            // we 'kind of' skip the strsep without an assignment
-            strsep(&buffer, delimiters); //this element says 'node'
-            id = strtoul(strsep(&buffer, delimiters), NULL, 0);
-            strsep(&buffer, delimiters); //this element says 'name'
-            strsep(&buffer, delimiters); //this element says 'place'
-            strsep(&buffer, delimiters); //this element says 'highway'
-            strsep(&buffer, delimiters); //this element says 'route'
-            strsep(&buffer, delimiters); //this element says 'ref'
-            strsep(&buffer, delimiters); //this element says 'oneway'
-            strsep(&buffer, delimiters); //this element says 'maxspeed'
-            lat = strtod(strsep(&buffer, delimiters), NULL);
-            lon = strtod(strsep(&buffer, delimiters), NULL);
-            node current_node = {.id=id, .lat=lat, .lon=lon};
-            (*nodes)[counter] = current_node;
-            counter++;
-        } else if (buffer[0] == 'w') {
-            // first call of get_edges with nsucc_only=true
-            // this is only for the nsucc computation for each node
-            // no edges added yet
-            // the last '0' parameter is only placeholder, later it will be of use
-            get_edges(fp, buffer, delimiters, nodes, nr_of_nodes, true, 0);
-        } else {
-            // break when not reading any more nodes or ways
-            break;
+static double parse_decimal(const char *position, const char *line_end) {
+    // parses a coordinate like -3.7038120 without strtod
+    // the digits are collected into an integer and divided once by a power of ten, both are exact doubles
+    // for up to 15 digits so the result is rounded exactly like strtod rounds it
+    // longer numbers (never in the exports) are left to strtod
+    static const double powers_of_ten[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+                                           1e13, 1e14, 1e15};
+    const char *start = position;
+    bool negative = false;
+    uint64_t mantissa = 0;
+    int nr_of_digits = 0;
+    int nr_of_decimals = 0;
+    char number[64];
+
+    if (position < line_end && (*position == '-' || *position == '+')) {
+        negative = *position == '-';
+        position++;
+    }
+    while (position < line_end && *position >= '0' && *position <= '9') {
+        mantissa = mantissa * 10 + (uint64_t) (*position++ - '0');
+        nr_of_digits++;
+    }
+    if (position < line_end && *position == '.') {
+        position++;
+        while (position < line_end && *position >= '0' && *position <= '9') {
+            mantissa = mantissa * 10 + (uint64_t) (*position++ - '0');
+            nr_of_digits++;
+            nr_of_decimals++;
         }
     }
-    fclose(fp);
-
+    if (nr_of_digits > 15 || (position < line_end && (*position == 'e' || *position == 'E'))) {
+        size_t length = (size_t) (line_end - start) < sizeof(number) - 1 ? (size_t) (line_end - start) :
+                        sizeof(number) - 1;
+        memcpy(number, start, length);
+        number[length] = '\0';
+        return strtod(number, NULL);
+    }
+    return negative ? -((double) mantissa / powers_of_ten[nr_of_decimals]) :
+           (double) mantissa / powers_of_ten[nr_of_decimals];
 }
 
-void build_edges(char *filename, node **nodes, unsigned long nr_of_nodes, unsigned int *current_nsucc) {
-    // this is method is called after all the nodes have been read
-    // and the number of neighbours of each node is known
-    // this function will go through the csv file again and add the edges to the
-    // adjacency list of the nodes
-    // this is mainly done by calling get_edges and providing nsucc_only=false and current_nsucc
-    // array of the current added neighbours in the adjacency list
+static void *resize_array(void *array, unsigned long capacity, size_t element_size) {
+    // resizes a growable array, exits if there is no memory left
+    if ((array = realloc(array, capacity * element_size)) == NULL) exit(1);
+    return array;
+}
 
-    const char delimiters[] = "|";
-    char *buffer;
-    size_t characters = 0;
-    FILE *fp = fopen(filename, "r");
+bool get_node(const char *line, const char *line_end, Graph *graph, unsigned long *capacity) {
+    // appends the node of a 'node' line to the node arrays of the graph
+    // node|id|name|place|highway|route|ref|oneway|maxspeed|lat|lon
+    // returns false without the node if the graph is full,
+    // the indices have to fit into the parents of the search states
+    const char *field = next_field(line, line_end);
+
+    if (graph->nr_of_nodes >= NO_PARENT - 1) return false;
+    if (graph->nr_of_nodes == *capacity) {
+        *capacity = *capacity == 0 ? 1024 : 2 * *capacity;
+        graph->ids = resize_array(graph->ids, *capacity, sizeof(uint64_t));
+        graph->lat = resize_array(graph->lat, *capacity, sizeof(double));
+        graph->lon = resize_array(graph->lon, *capacity, sizeof(double));
+    }
+    graph->ids[graph->nr_of_nodes] = parse_unsigned(field, line_end);
+    for (int i = 0; i < 8; ++i) {
+        field = next_field(field, line_end); // name, place, highway, route, ref, oneway, maxspeed
+    }
+    graph->lat[graph->nr_of_nodes] = parse_decimal(field, line_end);
+    field = next_field(field, line_end);
+    graph->lon[graph->nr_of_nodes] = parse_decimal(field, line_end);
+    graph->nr_of_nodes++;
+    return true;
+}
 
-    buffer = (char *) malloc(characters * sizeof(char));
+void add_edge(EdgeList *edges, unsigned long tail_index, unsigned long head_index) {
+    // appends the edge tail_index -> head_index to the edge list
+    // tail and head are indexes, i.e. positions in the node arrays, not ids.
+    if (edges->size == edges->capacity) {
+        edges->capacity = edges->capacity == 0 ? 1024 : 2 * edges->capacity;
+        edges->tails = resize_array(edges->tails, edges->capacity, sizeof(uint32_t));
+        edges->heads = resize_array(edges->heads, edges->capacity, sizeof(uint32_t));
+    }
+    edges->tails[edges->size] = (uint32_t) tail_index;
+    edges->heads[edges->size] = (uint32_t) head_index;
+    edges->size++;
+}
 
-    //skip the first three lines of the file because they start with #
-    characters = (size_t) getline(&buffer, &characters, fp);
-    characters = (size_t) getline(&buffer, &characters, fp);
-    characters = (size_t) getline(&buffer, &characters, fp);
+void get_edges(const char *line, const char *line_end, Graph *graph, EdgeList *edges) {
+    // appends the edges of one 'way' line to the edge list, all nodes have to be read before
+    // way|id|name|highway|route|ref|?|oneway|maxspeed|member|member|...
+    // ways of which the first or second member is unknown skip both members, a later unknown member
+    // only skips the edges to it, like the parser always did
 
+    const char *field = line;
+    bool oneway;
+    unsigned long head_id;
+    unsigned long tail_id;
+    unsigned long tail_index;
+    unsigned long head_index;
 
-    while ((characters = (size_t) getline(&buffer, &characters, fp)) > 0) {
-        if (buffer[0] == 'n') {
-            continue;
-        } else if (buffer[0] == 'w') {
-            get_edges(fp, buffer, delimiters, nodes, nr_of_nodes, false, current_nsucc);
+    for (int i = 0; i < 7; ++i) {
+        field = next_field(field, line_end); // skip the first 7 useless entries
+    }
+    oneway = line_end - field >= 7 && memcmp(field, "oneway|", 7) == 0;
+    field = next_field(field, line_end);
+    field = next_field(field, line_end); // skip maxspeed
+
+    // now the member nodes
+    // we assume that there is no node with id=0 which is the case for catalunya and spain
+    // an empty member or the end of the line is read as 0
+    tail_id = field < line_end ? parse_unsigned(field, line_end) : 0;
+    field = next_field(field, line_end);
+    head_id = field < line_end ? parse_unsigned(field, line_end) : 0;
+    field = next_field(field, line_end);
+    while (tail_id != 0 && head_id != 0) { // while not reached end of line
+        // we need the indices to access the node arrays
+        tail_index = get_node_by_id(graph, tail_id);
+        head_index = get_node_by_id(graph, head_id);
+        // we can only add edges if both tail and head exist in the node list
+        // otherwise we have to ignore them and move on (see the elses)
+        if (tail_index != ULONG_MAX && head_index != ULONG_MAX) {
+            add_edge(edges, tail_index, head_index);
+            if (oneway == false) add_edge(edges, head_index, tail_index);
+            tail_id = head_id;
+        } else if (tail_index == ULONG_MAX && head_index != ULONG_MAX) {
+            tail_id = head_id;
         } else {
-            // break when not reading any more nodes or ways
-            break;
+            tail_id = field < line_end ? parse_unsigned(field, line_end) : 0;
+            field = next_field(field, line_end);
         }
+        head_id = field < line_end ? parse_unsigned(field, line_end) : 0;
+        field = next_field(field, line_end);
     }
-    fclose(fp);
 }
 
+int build_edges(Graph *graph, CsvChunk *chunks, unsigned long nr_of_chunks) {
+    // builds the CSR arrays of the graph from the edge lists of the chunks with a counting sort by tail
+    // the sort is stable and takes the chunks in order, so the successors of every node keep the order of the file
+    // returns 0 or ASTAR_TOO_LARGE if the edges do not fit into the 32 bit offsets
+
+    unsigned long n = graph->nr_of_nodes;
+    unsigned long nr_of_edges = 0;
+    uint32_t *position;
+    EdgeList *edges;
+    DistanceKernel kernel;
+    double distances[DISTANCE_BATCH];
+    uint32_t count;
+
+    for (unsigned long c = 0; c < nr_of_chunks; ++c) {
+        nr_of_edges += chunks[c].edges.size;
+    }
+    if (nr_of_edges > UINT32_MAX) return ASTAR_TOO_LARGE;
+    graph->nr_of_edges = nr_of_edges;
+    graph->offsets = calloc(n + 1, sizeof(uint32_t));
+    graph->targets = malloc(graph->nr_of_edges * sizeof(uint32_t));
+    graph->weights = malloc(graph->nr_of_edges * sizeof(float));
+    position = malloc(n * sizeof(uint32_t));
+    if (graph->offsets == NULL || graph->targets == NULL || graph->weights == NULL || position == NULL) exit(1);
+
+    // offsets[i+1] counts the successors of node i until the prefix sum
+    for (unsigned long c = 0; c < nr_of_chunks; ++c) {
+        edges = &chunks[c].edges;
+        for (unsigned long i = 0; i < edges->size; ++i) {
+            graph->offsets[edges->tails[i] + 1]++;
+        }
+    }
+    for (unsigned long i = 0; i < n; ++i) {
+        graph->offsets[i + 1] += graph->offsets[i];
+        position[i] = graph->offsets[i];
+    }
+    for (unsigned long c = 0; c < nr_of_chunks; ++c) {
+        edges = &chunks[c].edges;
+        for (unsigned long i = 0; i < edges->size; ++i) {
+            graph->targets[position[edges->tails[i]]++] = edges->heads[i];
+        }
+    }
+    free(position);
+
+    // the lengths of the edges of a node are computed together by the distance kernel
+    kernel = distance_kernel();
+    for (unsigned long tail = 0; tail < n; ++tail) {
+        for (uint32_t i = graph->offsets[tail]; i < graph->offsets[tail + 1]; i += count) {
+            count = graph->offsets[tail + 1] - i < DISTANCE_BATCH ? graph->offsets[tail + 1] - i : DISTANCE_BATCH;
+            kernel(graph, graph->targets + i, count, tail, distances);
+            for (uint32_t j = 0; j < count; ++j) graph->weights[i + j] = (float) distances[j];
+        }
+    }
+    return 0;
+}
 
-unsigned long get_next_edge_node(char **buffer, const char *delimiters) {
-    // helper function to return the id while reading the member nodes in the ways
-    // returns 0 if there are no more member nodes to read, i.e. end of line
-    // we assume that there is no nodes with id 0, which is the case for cataluna.csv and spain.csv
-    char *text = strsep(buffer, delimiters);
-    if (text == NULL) {
-        return 0;
-    } else {
-        return strtoul(text, NULL, 0);
+static const char *line_end_of(const char *line, const char *end) {
+    // returns the newline which ends the line or end if there is none before it
+    const char *line_end = memchr(line, '\n', (size_t) (end - line));
+    return line_end == NULL ? end : line_end;
+}
+
+static void split_into_chunks(CsvImport *import, const char *text, const char *text_end) {
+    // splits the text into import->nr_of_chunks pieces of about the same size, each ending after a newline,
+    // and resets the chunks and the cursor for the next phase
+
+    const char *end;
+
+    for (unsigned long i = 0; i < import->nr_of_chunks; ++i) {
+        memset(&import->chunks[i], 0, sizeof(CsvChunk));
+        import->chunks[i].start = i == 0 ? text : import->chunks[i - 1].end;
+        end = text + (text_end - text) * (long) (i + 1) / (long) import->nr_of_chunks;
+        if (end <= import->chunks[i].start) {
+            end = import->chunks[i].start;
+        } else if (end < text_end && end[-1] != '\n') {
+            end = line_end_of(end, text_end);
+            if (end < text_end) end++;
+        }
+        import->chunks[i].end = end;
     }
+    import->next_chunk = 0;
 }
 
-void add_edge(node **nodes, unsigned long tail_index, unsigned long head_index, unsigned int position) {
-    // method which adds edges to the nodes list
-    // adds edge tail_index -> head_index
-    // tail and ead are indexes, i.e. positions in the nodes array, not ids.
-    // position is used to get the current position in the adjacency list of the tail node
-    *((((*nodes) + tail_index)->successors) + position) = head_index;
+static void *node_worker(void *argument) {
+    // parses the node lines of the chunks it takes, a chunk stops at its first other line or when it is full
+    CsvImport *import = argument;
+    CsvChunk *chunk;
+    const char *line;
+    unsigned long i;
+
+    while ((i = __sync_fetch_and_add(&import->next_chunk, 1)) < import->nr_of_chunks) {
+        chunk = &import->chunks[i];
+        for (line = chunk->start; line < chunk->end && line[0] == 'n'; line = line_end_of(line, chunk->end) + 1) {
+            if (!get_node(line, line_end_of(line, chunk->end), &chunk->nodes, &chunk->capacity)) {
+                chunk->too_large = true;
+                break;
+            }
+        }
+        chunk->stop = line < chunk->end ? line : chunk->end;
+    }
+    return NULL;
 }
 
-void get_edges(FILE *fp, char *buffer, const char *delimiters, node **nodes, unsigned long nr_of_nodes, bool nsucc_only,
-               unsigned int *current_nsucc) {
-    // method for adding the edges to the nodes array
-    // gets called within the get_nodes function after reading all the nodes
-    // (to collect the number of neighbours for each node, nsucc_only=true)
-    // and from build_edges to really build the edges in the graph (nsucc_only=false)
-    // current_nsucc is provided by build_edges and provides the /current/ number of neighbours during the adding
+static void *way_worker(void *argument) {
+    // parses the way lines of the chunks it takes against the merged nodes, a chunk stops at its first other line
+    CsvImport *import = argument;
+    CsvChunk *chunk;
+    const char *line;
+    unsigned long i;
+
+    while ((i = __sync_fetch_and_add(&import->next_chunk, 1)) < import->nr_of_chunks) {
+        chunk = &import->chunks[i];
+        for (line = chunk->start; line < chunk->end && line[0] == 'w'; line = line_end_of(line, chunk->end) + 1) {
+            get_edges(line, line_end_of(line, chunk->end), import->graph, &chunk->edges);
+        }
+        chunk->stop = line < chunk->end ? line : chunk->end;
+        chunk->misplaced_node = chunk->stop < chunk->end && chunk->stop[0] == 'n';
+    }
+    return NULL;
+}
 
+static unsigned long nr_of_parsed_chunks(CsvImport *import) {
+    // the lines of a phase end in the first chunk which stopped early, the later chunks do not count
+    unsigned long nr_of_chunks = 0;
 
-    bool oneway;
-    unsigned long head_id;
-    unsigned long tail_id;
-    unsigned long tail_index;
-    unsigned long head_index;
-    size_t characters;
+    while (nr_of_chunks < import->nr_of_chunks) {
+        nr_of_chunks++;
+        if (import->chunks[nr_of_chunks - 1].stop < import->chunks[nr_of_chunks - 1].end) break;
+    }
+    return nr_of_chunks;
+}
 
-    while (buffer[0] == 'w') {
-        for (int i = 0; i < 7; ++i) {
-            strsep(&buffer, delimiters); // skip the first 7 useless entries
-        }
-        if (strcmp(strsep(&buffer, delimiters), "oneway") == 0) {
-            oneway = true;
-        } else {
-            oneway = false;
-        }
-        strsep(&buffer, delimiters); // skip maxspeed
-
-        // now the member nodes
-        // we assume that there is no node with id=0 which is the case for catalunya and spain
-        // this is important because strtoul returns 0 if the input is not a valid unsigned long
-        // which would be ambiguous in the case of a node with id=0
-        tail_id = strtoul(strsep(&buffer, delimiters), NULL, 0);
-        head_id = strtoul(strsep(&buffer, delimiters), NULL, 0);
-        while (tail_id != 0 && head_id != 0) { // while not reached end of line
-            // we need the indices to access the nodes array/list
-            tail_index = get_node_by_id(*nodes, nr_of_nodes, tail_id);
-            head_index = get_node_by_id(*nodes, nr_of_nodes, head_id);
-            // we can only add edges (or count the number of neighbours
-            // both tail and head exists in the node list
-            // otherwise we have to ignore them and move on (see the elses)
-            if (tail_index != ULONG_MAX && head_index != ULONG_MAX) {
-                if (nsucc_only == true) {
-                    ((*nodes) + tail_index)->nsucc++;
-                    if (oneway == false) ((*nodes) + head_index)->nsucc++;
-                } else {
-                    add_edge(nodes, tail_index, head_index, current_nsucc[tail_index]);
-                    current_nsucc[tail_index]++;
-                    if (oneway == false) {
-                        add_edge(nodes, head_index, tail_index, current_nsucc[head_index]);
-                        current_nsucc[head_index]++;
-                    }
-                }
-                tail_id = head_id;
-                head_id = get_next_edge_node(&buffer, delimiters);
-            } else if (tail_index == ULONG_MAX && head_index != ULONG_MAX) {
-                tail_id = head_id;
-                head_id = get_next_edge_node(&buffer, delimiters);
-            } else {
-                tail_id = get_next_edge_node(&buffer, delimiters);
-                head_id = get_next_edge_node(&buffer, delimiters);
-            }
+static const char *merge_nodes(CsvImport *import) {
+    // copies the nodes of the parsed chunks in order into the graph and frees the node arrays of all chunks
+    // and records whether the ids are in ascending order, a .csv does not have to list its nodes that way
+    // returns where the node lines end or NULL if there are too many nodes, the indices have to fit into the parents
+    // of the search states
+
+    Graph *graph = import->graph;
+    unsigned long nr_of_chunks = nr_of_parsed_chunks(import);
+    unsigned long position = 0;
+    bool too_large = false;
+    CsvChunk *chunk;
+
+    for (unsigned long c = 0; c < nr_of_chunks; ++c) {
+        graph->nr_of_nodes += import->chunks[c].nodes.nr_of_nodes;
+        too_large = too_large || import->chunks[c].too_large;
+    }
+    if (too_large || graph->nr_of_nodes >= NO_PARENT) {
+        for (unsigned long c = 0; c < import->nr_of_chunks; ++c) {
+            free(import->chunks[c].nodes.ids);
+            free(import->chunks[c].nodes.lat);
+            free(import->chunks[c].nodes.lon);
         }
-        characters = (size_t) getline(&buffer, &characters, fp);
+        graph->nr_of_nodes = 0;
+        return NULL;
     }
-
-    // nsucc_only is true we have know now the number of neighbours for each node
-    // therefore we allocate the memory for the adjacency list once for all nodes
-    // to avoid reallocations
-    if (nsucc_only == true) {
-        for (unsigned long i = 0; i < nr_of_nodes; ++i) {
-            ((*nodes) + i)->successors = malloc(((*nodes) + i)->nsucc * sizeof(unsigned long));
+    graph->ids = malloc(graph->nr_of_nodes * sizeof(uint64_t));
+    graph->lat = malloc(graph->nr_of_nodes * sizeof(double));
+    graph->lon = malloc(graph->nr_of_nodes * sizeof(double));
+    if (graph->ids == NULL || graph->lat == NULL || graph->lon == NULL) exit(1);
+
+    for (unsigned long c = 0; c < import->nr_of_chunks; ++c) {
+        chunk = &import->chunks[c];
+        if (c < nr_of_chunks) {
+            memcpy(graph->ids + position, chunk->nodes.ids, chunk->nodes.nr_of_nodes * sizeof(uint64_t));
+            memcpy(graph->lat + position, chunk->nodes.lat, chunk->nodes.nr_of_nodes * sizeof(double));
+            memcpy(graph->lon + position, chunk->nodes.lon, chunk->nodes.nr_of_nodes * sizeof(double));
+            position += chunk->nodes.nr_of_nodes;
         }
+        free(chunk->nodes.ids);
+        free(chunk->nodes.lat);
+        free(chunk->nodes.lon);
+    }
+    graph->ids_sorted = true;
+    for (unsigned long i = 1; i < graph->nr_of_nodes && graph->ids_sorted; ++i) {
+        graph->ids_sorted = graph->ids[i - 1] <= graph->ids[i];
     }
+    return import->chunks[nr_of_chunks - 1].stop;
+}
 
+static uint64_t align_to_page(uint64_t offset) {
+    // returns the next multiple of GRAPH_PAGE_SIZE which is at least offset
+    return (offset + GRAPH_PAGE_SIZE - 1) / GRAPH_PAGE_SIZE * GRAPH_PAGE_SIZE;
 }
 
+int write_sections(FILE *fout, void *header, size_t header_size, GraphFileSection *sections, void **data,
+                   uint64_t *size, int nr_of_sections) {
+    // writes a file made of a header and page aligned sections, used for all binary files of the router
+    // sections points to the section table inside the header, it is filled here from the data and sizes
+    // (a NULL data pointer leaves the section out) before the header is written
+    // returns 0 or ASTAR_WRITE_ERROR
+
+    uint64_t offset = align_to_page(header_size);
+    static const char padding[GRAPH_PAGE_SIZE] = {0};
+
+    for (int i = 0; i < nr_of_sections; ++i) {
+        if (data[i] == NULL) continue;
+        sections[i].offset = offset;
+        sections[i].size = size[i];
+        offset = align_to_page(offset + size[i]);
+    }
 
-void write_binary_file(char *filename, node *nodes, unsigned long nr_of_nodes) {
-    // writes a constructed graph (i.e. nodes list) to a binary file for a later very fast re-read
+    /* Global data --- header */
+    if (fwrite(header, header_size, 1, fout) != 1) return ASTAR_WRITE_ERROR;
+    offset = header_size;
+
+    /* Writing the sections, each padded with zeros to its page aligned offset */
+    for (int i = 0; i < nr_of_sections; ++i) {
+        if (data[i] == NULL) continue;
+        if (fwrite(padding, 1, sections[i].offset - offset, fout) != sections[i].offset - offset)
+            return ASTAR_WRITE_ERROR;
+        if (fwrite(data[i], 1, size[i], fout) != size[i]) return ASTAR_WRITE_ERROR;
+        offset = sections[i].offset + size[i];
+    }
+    return 0;
+}
 
-    FILE *fin;
-    unsigned long ntotnsucc = 0UL;
-    for (unsigned long i = 0; i < nr_of_nodes; i++) ntotnsucc += nodes[i].nsucc;
+int map_file(const char *filename, size_t header_size, void **mapping, size_t *mapping_size) {
+    // maps a whole file read-only, it has to be at least as large as its header
+    // returns 0, ASTAR_OPEN_ERROR if the file can not be opened or ASTAR_READ_ERROR if it can not be mapped
 
-    strcpy(strrchr(filename, '.'), ".bin");
+    int fd;
+    struct stat file_status;
 
-    if ((fin = fopen(filename, "wb")) == NULL) exit(31);
+    *mapping = NULL;
+    if ((fd = open(filename, O_RDONLY)) == -1) return ASTAR_OPEN_ERROR;
+    if (fstat(fd, &file_status) == -1 || (size_t) file_status.st_size < header_size) {
+        close(fd);
+        return ASTAR_READ_ERROR;
+    }
 
-    /* Global data --- header */
-    if (fwrite(&nr_of_nodes, sizeof(unsigned long), 1, fin) + fwrite(&ntotnsucc, sizeof(unsigned long), 1, fin) != 2)
-        exit(33);
-
-    /* Writing all nodes */
-    if (fwrite(nodes, sizeof(node), nr_of_nodes, fin) != nr_of_nodes) exit(33);
-
-    /* Writing sucessors in blocks */
-    for (unsigned long i = 0; i < nr_of_nodes; i++)
-        if (nodes[i].nsucc) {
-            if (fwrite(nodes[i].successors, sizeof(unsigned long), nodes[i].nsucc, fin) !=
-                nodes[i].nsucc)
-                exit(33);
-        }
-    fclose(fin);
+    *mapping_size = (size_t) file_status.st_size;
+    *mapping = mmap(NULL, *mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (*mapping == MAP_FAILED) {
+        *mapping = NULL;
+        return ASTAR_READ_ERROR;
+    }
+    return 0;
 }
 
+void *map_optional_section(void *mapping, size_t mapping_size, GraphFileSection *section, uint64_t expected_size,
+                           bool *valid) {
+    // returns a pointer to a section of a mapped file or NULL if the file does not have the section
+    // the section has to have the size the counts in the header imply and has to lie inside the file
+    // clears valid if the section does not fit, so a reader can map all sections before it checks once
+
+    if (section->offset == 0) return NULL;
+    if (section->size != expected_size || section->offset % GRAPH_PAGE_SIZE != 0 ||
+        section->offset + section->size > mapping_size) {
+        *valid = false;
+        return NULL;
+    }
+    return (char *) mapping + section->offset;
+}
 
-unsigned long read_binary_file(char *filename, node **nodes) {
-    // reads a binary files which has been written before by write_binary_file
-    // this is method is way faster than read_csv_file
+void *map_section(void *mapping, size_t mapping_size, GraphFileSection *section, uint64_t expected_size,
+                  bool *valid) {
+    // like map_optional_section but also clears valid if the section is missing
+    void *data = map_optional_section(mapping, mapping_size, section, expected_size, valid);
 
-    unsigned long nr_of_nodes;
-    FILE *fin;
-    unsigned long ntotnsucc = 0UL;
-    unsigned long *allsuccessors;
+    if (data == NULL) *valid = false;
+    return data;
+}
 
-    if ((fin = fopen(filename, "r")) == NULL) exit(31);
+static void graph_section_data(Graph *graph, void **data, uint64_t *size) {
+    // lists the arrays of the graph and their sizes in bytes in the order of the section table
+    unsigned long n = graph->nr_of_nodes;
+    unsigned long m = graph->nr_of_edges;
+
+    data[SECTION_IDS] = graph->ids;
+    size[SECTION_IDS] = n * sizeof(uint64_t);
+    data[SECTION_LAT] = graph->lat;
+    size[SECTION_LAT] = n * sizeof(double);
+    data[SECTION_LON] = graph->lon;
+    size[SECTION_LON] = n * sizeof(double);
+    data[SECTION_OFFSETS] = graph->offsets;
+    size[SECTION_OFFSETS] = (n + 1) * sizeof(uint32_t);
+    data[SECTION_TARGETS] = graph->targets;
+    size[SECTION_TARGETS] = m * sizeof(uint32_t);
+    data[SECTION_WEIGHTS] = graph->weights;
+    size[SECTION_WEIGHTS] = m * sizeof(float);
+    data[SECTION_REVERSE_OFFSETS] = graph->reverse_offsets;
+    size[SECTION_REVERSE_OFFSETS] = (n + 1) * sizeof(uint32_t);
+    data[SECTION_SOURCES] = graph->sources;
+    size[SECTION_SOURCES] = m * sizeof(uint32_t);
+    data[SECTION_REVERSE_WEIGHTS] = graph->reverse_weights;
+    size[SECTION_REVERSE_WEIGHTS] = m * sizeof(float);
+    data[SECTION_ID_INDEX] = graph->id_index;
+    size[SECTION_ID_INDEX] = graph->id_index_size * sizeof(uint32_t);
+    data[SECTION_LAT_E7] = graph->lat_e7;
+    size[SECTION_LAT_E7] = n * sizeof(int32_t);
+    data[SECTION_LON_E7] = graph->lon_e7;
+    size[SECTION_LON_E7] = n * sizeof(int32_t);
+    data[SECTION_UNIT_X] = graph->unit_x;
+    size[SECTION_UNIT_X] = n * sizeof(double);
+    data[SECTION_UNIT_Y] = graph->unit_y;
+    size[SECTION_UNIT_Y] = n * sizeof(double);
+    data[SECTION_UNIT_Z] = graph->unit_z;
+    size[SECTION_UNIT_Z] = n * sizeof(double);
+    data[SECTION_SPATIAL_INDEX] = graph->spatial_index;
+    size[SECTION_SPATIAL_INDEX] = graph->spatial_index != NULL ? spatial_index_size(graph->spatial_index) : 0;
+}
 
-    /* Global data --- header */
-    if (fread(&nr_of_nodes, sizeof(unsigned long), 1, fin) + fread(&ntotnsucc, sizeof(unsigned long), 1, fin) != 2)
-        exit(12);
+int write_binary_file(const char *filename, Graph *graph) {
+    // writes a constructed graph (i.e. the CSR arrays) to a binary file for a later very fast re-read
+    // the file starts with a GraphFileHeader, every array follows in its own page aligned section
+    // so read_binary_file can map the file instead of reading it
+    // returns 0, ASTAR_OPEN_ERROR or ASTAR_WRITE_ERROR
+
+    FILE *fout;
+    int code;
+    GraphFileHeader header;
+    void *data[GRAPH_MAX_SECTIONS] = {NULL};
+    uint64_t size[GRAPH_MAX_SECTIONS] = {0};
+
+    memset(&header, 0, sizeof(GraphFileHeader));
+    memcpy(header.magic, GRAPH_MAGIC, sizeof(header.magic));
+    header.version = GRAPH_VERSION;
+    header.endianness = GRAPH_ENDIANNESS;
+    header.nr_of_nodes = graph->nr_of_nodes;
+    header.nr_of_edges = graph->nr_of_edges;
+    header.flags = graph->ids_sorted ? GRAPH_IDS_SORTED : 0;
+    header.fingerprint = graph->fingerprint = graph_fingerprint(graph);
+    graph_section_data(graph, data, size);
+
+    if ((fout = fopen(filename, "wb")) == NULL) return ASTAR_OPEN_ERROR;
+    code = write_sections(fout, &header, sizeof(GraphFileHeader), header.sections, data, size, GRAPH_MAX_SECTIONS);
+    if (fclose(fout) != 0 && code == 0) code = ASTAR_WRITE_ERROR;
+    return code;
+}
 
-    /* getting memory for all data */
-    if ((*nodes = (node *) malloc(nr_of_nodes * sizeof(node))) == NULL) exit(32);
 
-    if ((allsuccessors = (unsigned long *) malloc(ntotnsucc * sizeof(unsigned long))) == NULL) exit(32);
+int read_binary_file(const char *filename, Graph *graph) {
+    // maps a binary file which has been written before by write_binary_file
+    // the graph arrays point directly into the read-only mapping, nothing is copied
+    // so the graph can be used right away and processes reading the same file share the page cache
+    // returns 0 or the code of map_file, files with another magic, version or byte order and files whose
+    // sections do not fit are rejected with ASTAR_READ_ERROR and leave nothing mapped
 
-    /* Reading all data from file */
-    if (fread(*nodes, sizeof(node), nr_of_nodes, fin) != nr_of_nodes) exit(32);
+    GraphFileHeader *header;
+    GraphFileSection *sections;
+    unsigned long n, m;
+    bool valid = true;
+    int code;
 
-    if (fread(allsuccessors, sizeof(unsigned long), ntotnsucc, fin) != ntotnsucc) exit(32);
+    memset(graph, 0, sizeof(Graph));
+    if ((code = map_file(filename, sizeof(GraphFileHeader), &graph->mapping, &graph->mapping_size)) != 0) return code;
 
-    fclose(fin);
-    /* Setting pointers to successors */
-    for (unsigned long i = 0; i < nr_of_nodes; i++)
-        if ((*nodes)[i].nsucc) {
-            (*nodes)[i].successors = allsuccessors;
-            allsuccessors += (*nodes)[i].nsucc;
-        }
-    return nr_of_nodes;
-}
+    /* Global data --- header */
+    header = graph->mapping;
+    n = graph->nr_of_nodes = header->nr_of_nodes;
+    m = graph->nr_of_edges = header->nr_of_edges;
+    // n also has to fit into the parents of the search states
+    if (memcmp(header->magic, GRAPH_MAGIC, sizeof(header->magic)) != 0 || header->version != GRAPH_VERSION ||
+        header->endianness != GRAPH_ENDIANNESS || n >= NO_PARENT) {
+        free_graph(graph);
+        return ASTAR_READ_ERROR;
+    }
+    graph->ids_sorted = (header->flags & GRAPH_IDS_SORTED) != 0;
+    graph->fingerprint = header->fingerprint;
+    sections = header->sections;
+
+    /* Setting pointers to the sections */
+    graph->ids = map_section(header, graph->mapping_size, &sections[SECTION_IDS], n * sizeof(uint64_t), &valid);
+    // either the double or the fixed-point coordinates
+    graph->lat_e7 = map_optional_section(header, graph->mapping_size, &sections[SECTION_LAT_E7],
+                                         n * sizeof(int32_t), &valid);
+    graph->lon_e7 = map_optional_section(header, graph->mapping_size, &sections[SECTION_LON_E7],
+                                         n * sizeof(int32_t), &valid);
+    if (graph->lat_e7 == NULL || graph->lon_e7 == NULL) {
+        graph->lat_e7 = graph->lon_e7 = NULL;
+        graph->lat = map_section(header, graph->mapping_size, &sections[SECTION_LAT], n * sizeof(double), &valid);
+        graph->lon = map_section(header, graph->mapping_size, &sections[SECTION_LON], n * sizeof(double), &valid);
+    }
+    graph->offsets = map_section(header, graph->mapping_size, &sections[SECTION_OFFSETS], (n + 1) * sizeof(uint32_t),
+                                 &valid);
+    graph->targets = map_section(header, graph->mapping_size, &sections[SECTION_TARGETS], m * sizeof(uint32_t),
+                                 &valid);
+    graph->weights = map_section(header, graph->mapping_size, &sections[SECTION_WEIGHTS], m * sizeof(float), &valid);
+    graph->reverse_offsets = map_optional_section(header, graph->mapping_size, &sections[SECTION_REVERSE_OFFSETS],
+                                                  (n + 1) * sizeof(uint32_t), &valid);
+    graph->sources = map_optional_section(header, graph->mapping_size, &sections[SECTION_SOURCES],
+                                          m * sizeof(uint32_t), &valid);
+    graph->reverse_weights = map_optional_section(header, graph->mapping_size, &sections[SECTION_REVERSE_WEIGHTS],
+                                                  m * sizeof(float), &valid);
+    graph->id_index_size = id_index_size(n);
+    graph->id_index = map_optional_section(header, graph->mapping_size, &sections[SECTION_ID_INDEX],
+                                           graph->id_index_size * sizeof(uint32_t), &valid);
+    graph->unit_x = map_optional_section(header, graph->mapping_size, &sections[SECTION_UNIT_X], n * sizeof(double),
+                                         &valid);
+    graph->unit_y = map_optional_section(header, graph->mapping_size, &sections[SECTION_UNIT_Y], n * sizeof(double),
+                                         &valid);
+    graph->unit_z = map_optional_section(header, graph->mapping_size, &sections[SECTION_UNIT_Z], n * sizeof(double),
+                                         &valid);
+    // the size of the spatial index is in its own header
+    graph->spatial_index = map_optional_section(header, graph->mapping_size, &sections[SECTION_SPATIAL_INDEX],
+                                                sections[SECTION_SPATIAL_INDEX].size, &valid);
+    if (graph->spatial_index != NULL && (sections[SECTION_SPATIAL_INDEX].size < sizeof(SpatialIndex) ||
+                                         spatial_index_size(graph->spatial_index) !=
+                                         sections[SECTION_SPATIAL_INDEX].size ||
+                                         graph->spatial_index->nr_of_indexed_nodes > n)) {
+        valid = false;
+    }
+    if (!valid) {
+        free_graph(graph);
+        return ASTAR_READ_ERROR;
+    }
 
+    /* The reverse graph is built here if the file was written without it */
+    if (graph->reverse_offsets == NULL || graph->sources == NULL || graph->reverse_weights == NULL) {
+        build_reverse_graph(graph);
+        graph->reverse_allocated = true;
+    }
 
-unsigned long read_csv_file(char *filename, node **nodes) {
-    // reads a .csv file and writes it to a binary file for a later fast re-read
+    /* The same for the id index */
+    if (graph->id_index == NULL) {
+        build_id_index(graph);
+        graph->id_index_allocated = true;
+    }
 
-    unsigned long nr_of_nodes = 0;
-    // count number of nodes for a proper array initialization no reallocs
-    // also number of neighbours for each nodes are read beforehand and stored
-    // therefore we only have to allocate memory for the adjacency lists once
-    nr_of_nodes = get_nr_of_nodes(filename);
-    get_nodes(filename, nodes, nr_of_nodes);
-    unsigned int *current_nsucc = (unsigned int *) calloc(nr_of_nodes, sizeof(unsigned int));
-    build_edges(filename, nodes, nr_of_nodes, current_nsucc);
-    free(current_nsucc);
+    /* And for the unit vectors */
+    if (graph->unit_x == NULL || graph->unit_y == NULL || graph->unit_z == NULL) {
+        build_unit_vectors(graph);
+        graph->unit_vectors_allocated = true;
+    }
 
-    write_binary_file(filename, *nodes, nr_of_nodes);
-    return nr_of_nodes;
+    /* And for the spatial index, which needs the reverse graph */
+    if (graph->spatial_index == NULL) {
+        build_spatial_index(graph);
+        graph->spatial_index_allocated = true;
+    }
+    return 0;
 }
 
 
+void free_graph(Graph *graph) {
+    // releases the graph, either the mapping of the file or all arrays
+    if (graph->mapping != NULL) {
+        munmap(graph->mapping, graph->mapping_size);
+    } else {
+        free(graph->ids);
+        free(graph->lat);
+        free(graph->lon);
+        free(graph->lat_e7);
+        free(graph->lon_e7);
+        free(graph->offsets);
+        free(graph->targets);
+        free(graph->weights);
+    }
+    if (graph->mapping == NULL || graph->reverse_allocated) {
+        free(graph->reverse_offsets);
+        free(graph->sources);
+        free(graph->reverse_weights);
+    }
+    if (graph->mapping == NULL || graph->id_index_allocated) free(graph->id_index);
+    if (graph->mapping == NULL || graph->spatial_index_allocated) free(graph->spatial_index);
+    if (graph->mapping == NULL || graph->unit_vectors_allocated) {
+        free(graph->unit_x);
+        free(graph->unit_y);
+        free(graph->unit_z);
+    }
+    memset(graph, 0, sizeof(Graph));
+}
+
+
+int read_csv_file(const char *filename, Graph *graph, unsigned int nr_of_threads, NodeOrder order,
+                  bool fixed_coordinates) {
+    // reads a .csv file into a graph, write_binary_file writes it to a binary file for a later fast re-read
+    // skips the first three lines (they start with #), then expects all node lines followed by the
+    // way lines and stops at the first other line (the relations)
+    // the nodes have to be sorted by id, the way members are looked up in them
+    //
+    // the mapped file is split into newline aligned chunks which nr_of_threads threads parse in two phases,
+    // first the node lines and then the way lines
+    // the chunks are always merged in order, so the .bin is the same for any number of threads
+    // at last the nodes are renumbered in the given order, see reorder_graph, and the spatial index is built
+    // with fixed_coordinates the coordinates are stored in 1e-7 degrees, the edge lengths are computed from those
+    // returns 0, the code of map_file, ASTAR_READ_ERROR if a node line follows the way lines or ASTAR_TOO_LARGE if
+    // the nodes or edges do not fit into the 32 bit indices
+
+    size_t size;
+    void *mapping;
+    char *text;
+    const char *text_end;
+    const char *line;
+    const char *ways;
+    CsvImport import;
+    unsigned long nr_of_way_chunks;
+    bool misplaced_node;
+    int code;
+
+    memset(graph, 0, sizeof(Graph));
+    if ((code = map_file(filename, 0, &mapping, &size)) != 0) return code;
+    text = mapping;
+    madvise(text, size, MADV_SEQUENTIAL);
+    text_end = text + size;
+    line = text;
+    for (int i = 0; i < 3 && line < text_end; ++i) {
+        line = line_end_of(line, text_end) + 1;
+    }
+    if (line > text_end) line = text_end;
+
+    import.graph = graph;
+    import.nr_of_chunks = nr_of_threads <= 1 ? 1 : (unsigned long) nr_of_threads * CSV_CHUNKS_PER_THREAD;
+    if ((import.chunks = malloc(import.nr_of_chunks * sizeof(CsvChunk))) == NULL) exit(1);
+
+    split_into_chunks(&import, line, text_end);
+    run_parallel(nr_of_threads, node_worker, &import);
+    if ((ways = merge_nodes(&import)) == NULL) {
+        munmap(text, size);
+        free(import.chunks);
+        return ASTAR_TOO_LARGE;
+    }
+    if (fixed_coordinates) to_fixed_coordinates(graph);
+    build_unit_vectors(graph);
+    build_id_index(graph);
+
+    split_into_chunks(&import, ways, text_end);
+    run_parallel(nr_of_threads, way_worker, &import);
+    nr_of_way_chunks = nr_of_parsed_chunks(&import);
+    // a node line instead of the relations would break the lookup by id
+    misplaced_node = import.chunks[nr_of_way_chunks - 1].misplaced_node;
+    munmap(text, size);
+
+    code = misplaced_node ? ASTAR_READ_ERROR : build_edges(graph, import.chunks, nr_of_way_chunks);
+    for (unsigned long c = 0; c < import.nr_of_chunks; ++c) {
+        free(import.chunks[c].edges.tails);
+        free(import.chunks[c].edges.heads);
+    }
+    free(import.chunks);
+    if (code != 0) {
+        free_graph(graph);
+        return code;
+    }
+    build_reverse_graph(graph);
+    reorder_graph(graph, order);
+    build_spatial_index(graph);
+    return 0;
+}
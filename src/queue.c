@@ -0,0 +1,426 @@
+// queue.c
+// priority queues for the OPEN set of the AStar algorithm
+// the d-ary heap is the default, the sorted linked list is kept for comparison
+// the radix heap relies on monotone fscores, i.e. a consistent heuristic
+
+
+#include "astar.h"
+
+void add_element_to_list(PriorityQueue* queue, unsigned long index_to_add, double fscore_of_index_to_add)
+{
+    // adds an element to a list
+    // the list is always sorted in ascending order
+    // the sorting key is the fscore, it is kept in the element, which is found by the index for queue_key
+    //
+    // the start of the list in the queue becomes the new element if it is the lowest
+
+    list_elem** start_of_list = &queue->list;
+    list_elem* next_elem = NULL;
+    list_elem* current_elem = NULL;
+    list_elem* new_elem = NULL;
+
+    // the element has to outlive this method, it is taken from the removed elements or the arena of the queue
+    if (queue->free_elems!=NULL) {
+        new_elem = queue->free_elems;
+        queue->free_elems = new_elem->next;
+    }
+    else {
+        new_elem = arena_alloc(&queue->list_arena, sizeof(list_elem));
+    }
+    queue->list_elem_of[index_to_add] = new_elem;
+
+    next_elem = *start_of_list;
+
+
+    // check if element is actually the lowest
+    if ((next_elem==NULL) ||
+            (fscore_of_index_to_add<=next_elem->key)) {
+        // add element to the beginning of the list
+        // and return new element as the start of the list
+        new_elem->index = index_to_add;
+        new_elem->key = fscore_of_index_to_add;
+        new_elem->next = next_elem;
+        *start_of_list = new_elem;
+        return;
+    }
+
+    // go through the list
+    while (next_elem->next!=NULL) {
+        current_elem = next_elem;
+        next_elem = next_elem->next;
+        if (fscore_of_index_to_add<=next_elem->key) {
+            // insert the element to the list between current_elem and next_elem
+            // and return the start of the list (it did'nt change)
+            new_elem->index = index_to_add;
+            new_elem->key = fscore_of_index_to_add;
+            new_elem->next = next_elem;
+            current_elem->next = new_elem;
+            return;
+        }
+    }
+    // we land here if we reached the end
+    // i.e. the element has the worst fscore
+    new_elem->index = index_to_add;
+    new_elem->key = fscore_of_index_to_add;
+    new_elem->next = NULL;
+    next_elem->next = new_elem;
+}
+
+bool remove_element_from_list(PriorityQueue* queue, unsigned long index_to_remove)
+{
+    // removes an element from a list
+    // the element is kept in the free elements of the queue for the next insertion
+    // returns false if the index is not in the list
+
+    list_elem** start_of_list = &queue->list;
+    list_elem* current_elem = *start_of_list;
+    list_elem* next_elem = NULL;
+
+    // check if first element is the wanted one
+    if (current_elem==NULL) return false;
+    if (current_elem->index==index_to_remove) {
+        *start_of_list = current_elem->next;
+        current_elem->next = queue->free_elems;
+        queue->free_elems = current_elem;
+        return true;
+    }
+
+    // go through the list
+    next_elem = current_elem->next;
+    while (next_elem!=NULL) {
+        if (next_elem->index==index_to_remove) {
+            current_elem->next = next_elem->next;
+            next_elem->next = queue->free_elems;
+            queue->free_elems = next_elem;
+            return true;
+        }
+        current_elem = next_elem;
+        next_elem = current_elem->next;
+    }
+    return false;
+}
+
+static void heap_sift_up(PriorityQueue* queue, unsigned long position)
+{
+    // moves the element at position up until its parent has a lower or equal key
+    // the position array is updated for every element that is moved
+
+    heap_elem elem = queue->heap[position];
+    unsigned long parent;
+
+    while (position>0) {
+        parent = (position-1)/HEAP_ARITY;
+        if (queue->heap[parent].key<=elem.key) break;
+        queue->heap[position] = queue->heap[parent];
+        queue->position[queue->heap[position].index] = (uint32_t) position;
+        position = parent;
+    }
+    queue->heap[position] = elem;
+    queue->position[elem.index] = (uint32_t) position;
+}
+
+static void heap_sift_down(PriorityQueue* queue, unsigned long position)
+{
+    // moves the element at position down until all of its children have a higher or equal key
+
+    heap_elem elem = queue->heap[position];
+    unsigned long first_child, last_child, min_child;
+
+    while ((first_child = position*HEAP_ARITY+1)<queue->size) {
+        last_child = first_child+HEAP_ARITY;
+        if (last_child>queue->size) last_child = queue->size;
+        min_child = first_child;
+        for (unsigned long child = first_child+1; child<last_child; ++child) {
+            if (queue->heap[child].key<queue->heap[min_child].key) min_child = child;
+        }
+        if (queue->heap[min_child].key>=elem.key) break;
+        queue->heap[position] = queue->heap[min_child];
+        queue->position[queue->heap[position].index] = (uint32_t) position;
+        position = min_child;
+    }
+    queue->heap[position] = elem;
+    queue->position[elem.index] = (uint32_t) position;
+}
+
+static unsigned long radix_key(double fscore)
+{
+    // converts an fscore in metres into the fixed-point millimetres used by the radix heap
+    if (fscore<=0) return 0;
+    return (unsigned long) (fscore*RADIX_SCALE+0.5);
+}
+
+static unsigned char radix_bucket_index(unsigned long key, unsigned long last_key)
+{
+    // bucket 0 holds the keys equal to the last popped key
+    // bucket i holds the keys whose highest bit different from last_key is bit i-1
+    if (key==last_key) return 0;
+    return (unsigned char) (64-__builtin_clzl(key^last_key));
+}
+
+static void radix_insert(PriorityQueue* queue, unsigned long index, unsigned long key)
+{
+    // appends the node to the bucket for its key
+    // the buckets only grow (doubling), so there is no allocation once they have their working size
+
+    radix_bucket* bucket;
+
+    // a consistent heuristic never produces keys below the last popped one
+    // but rounding of the distances can, those are treated as equal
+    if (key<queue->last_key) key = queue->last_key;
+
+    queue->bucket_of[index] = radix_bucket_index(key, queue->last_key);
+    bucket = &queue->buckets[queue->bucket_of[index]];
+    if (bucket->size==bucket->capacity) {
+        bucket->capacity = bucket->capacity ? 2*bucket->capacity : 64;
+        if ((bucket->elems = realloc(bucket->elems, bucket->capacity*sizeof(radix_elem)))==NULL) exit(1);
+    }
+    bucket->elems[bucket->size].key = key;
+    bucket->elems[bucket->size].index = index;
+    queue->position[index] = (uint32_t) bucket->size;
+    bucket->size++;
+}
+
+static void radix_remove(PriorityQueue* queue, unsigned long index)
+{
+    // removes the node from its bucket by moving the last element of the bucket into its place
+
+    radix_bucket* bucket = &queue->buckets[queue->bucket_of[index]];
+    unsigned long position = queue->position[index];
+
+    bucket->size--;
+    if (position!=bucket->size) {
+        bucket->elems[position] = bucket->elems[bucket->size];
+        queue->position[bucket->elems[position].index] = (uint32_t) position;
+    }
+}
+
+static unsigned long radix_pop(PriorityQueue* queue)
+{
+    // returns a node with the minimal key
+    // if bucket 0 is empty the first non-empty bucket is emptied into the lower buckets
+    // after its minimum became the new last key, every node is moved down at most 64 times
+
+    radix_bucket* bucket = &queue->buckets[0];
+    radix_elem* elems;
+    unsigned long nr_of_elems, min_key;
+    int i = 1;
+
+    if (bucket->size==0) {
+        while (queue->buckets[i].size==0) i++;
+        bucket = &queue->buckets[i];
+        min_key = bucket->elems[0].key;
+        for (unsigned long j = 1; j<bucket->size; ++j) {
+            if (bucket->elems[j].key<min_key) min_key = bucket->elems[j].key;
+        }
+        queue->last_key = min_key;
+
+        // all elements of bucket i end up in lower buckets, so its array stays untouched while we go through it
+        elems = bucket->elems;
+        nr_of_elems = bucket->size;
+        bucket->size = 0;
+        for (unsigned long j = 0; j<nr_of_elems; ++j) {
+            radix_insert(queue, elems[j].index, elems[j].key);
+        }
+        bucket = &queue->buckets[0];
+    }
+
+    bucket->size--;
+    return bucket->elems[bucket->size].index;
+}
+
+void queue_init(PriorityQueue* queue, QueueType type, unsigned long nr_of_nodes)
+{
+    // prepares an empty queue for a graph with nr_of_nodes nodes
+    // the heap gets all of its memory here, every node can be at most once in the OPEN set
+    // so there is no allocation during the search
+
+    queue->type = type;
+    queue->size = 0;
+    queue->heap = NULL;
+    queue->position = NULL;
+    queue->list = NULL;
+    queue->list_elem_of = NULL;
+    queue->free_elems = NULL;
+    arena_init(&queue->list_arena);
+    queue->bucket_of = NULL;
+    queue->last_key = 0;
+    queue->popped_key = 0;
+    queue->pushes = queue->decrease_keys = queue->pops = queue->max_size = 0;
+    memset(queue->buckets, 0, sizeof(queue->buckets));
+
+    if (type==DARY_HEAP) {
+        if ((queue->heap = malloc(nr_of_nodes*sizeof(heap_elem)))==NULL) exit(1);
+        if ((queue->position = malloc(nr_of_nodes*sizeof(uint32_t)))==NULL) exit(1);
+    }
+    else if (type==SORTED_LIST) {
+        if ((queue->list_elem_of = malloc(nr_of_nodes*sizeof(list_elem*)))==NULL) exit(1);
+    }
+    else if (type==RADIX_HEAP) {
+        if ((queue->position = malloc(nr_of_nodes*sizeof(uint32_t)))==NULL) exit(1);
+        if ((queue->bucket_of = malloc(nr_of_nodes*sizeof(unsigned char)))==NULL) exit(1);
+    }
+}
+
+void queue_free(PriorityQueue* queue)
+{
+    // releases the memory of the queue, the remaining elements are dropped
+
+    queue_clear(queue);
+    for (int i = 0; i<RADIX_BUCKETS; ++i) {
+        free(queue->buckets[i].elems);
+        queue->buckets[i].elems = NULL;
+        queue->buckets[i].capacity = 0;
+    }
+    free(queue->heap);
+    free(queue->position);
+    free(queue->bucket_of);
+    free(queue->list_elem_of);
+    arena_free(&queue->list_arena);
+    queue->heap = NULL;
+    queue->position = NULL;
+    queue->bucket_of = NULL;
+    queue->list_elem_of = NULL;
+}
+
+void queue_clear(PriorityQueue* queue)
+{
+    // removes all elements but keeps the memory, so the queue can be used for the next search
+    // the list elements all go back to the arena at once
+
+    queue->list = NULL;
+    queue->free_elems = NULL;
+    arena_reset(&queue->list_arena);
+    for (int i = 0; i<RADIX_BUCKETS; ++i) {
+        queue->buckets[i].size = 0;
+    }
+    queue->last_key = 0;
+    queue->size = 0;
+}
+
+bool queue_is_empty(PriorityQueue* queue)
+{
+    return queue->size==0;
+}
+
+void queue_push(PriorityQueue* queue, unsigned long index, double key)
+{
+    // adds the node index with the key (its fscore) to the queue
+    // the node must not be in the queue already
+
+    if (queue->type==SORTED_LIST) {
+        add_element_to_list(queue, index, key);
+    }
+    else if (queue->type==RADIX_HEAP) {
+        radix_insert(queue, index, radix_key(key));
+    }
+    else {
+        queue->heap[queue->size].key = (float) key;
+        queue->heap[queue->size].index = (uint32_t) index;
+        heap_sift_up(queue, queue->size);
+    }
+    queue->size++;
+    queue->pushes++;
+    if (queue->size>queue->max_size) queue->max_size = queue->size;
+}
+
+void queue_decrease_key(PriorityQueue* queue, unsigned long index, double key)
+{
+    // lowers the key of a node in the queue
+
+    queue->decrease_keys++;
+    if (queue->type==SORTED_LIST) {
+        // we have to remove and add the element again because the distances were updated
+        // and we want to keep a sorted list, a node which was not in the list is just added
+        if (!remove_element_from_list(queue, index)) queue->size++;
+        add_element_to_list(queue, index, key);
+    }
+    else if (queue->type==RADIX_HEAP) {
+        radix_remove(queue, index);
+        radix_insert(queue, index, radix_key(key));
+    }
+    else {
+        queue->heap[queue->position[index]].key = (float) key;
+        heap_sift_up(queue, queue->position[index]);
+    }
+}
+
+double queue_key(PriorityQueue* queue, unsigned long index)
+{
+    // returns the key of a node in the queue
+    // the searches keep h only here, a lower g gives the new key as queue_key-(old g-new g)
+
+    if (queue->type==SORTED_LIST) {
+        return queue->list_elem_of[index]->key;
+    }
+    if (queue->type==RADIX_HEAP) {
+        return queue->buckets[queue->bucket_of[index]].elems[queue->position[index]].key/RADIX_SCALE;
+    }
+    return queue->heap[queue->position[index]].key;
+}
+
+double queue_min_key(PriorityQueue* queue)
+{
+    // returns the lowest key in the queue, the key of the node queue_pop would return
+    // the queue must not be empty
+
+    radix_bucket* bucket;
+    unsigned long min_key;
+    int i = 0;
+
+    if (queue->type==SORTED_LIST) {
+        return queue->list->key;
+    }
+    if (queue->type==RADIX_HEAP) {
+        // like radix_pop, but only looks for the minimum of the first non-empty bucket
+        while (queue->buckets[i].size==0) i++;
+        bucket = &queue->buckets[i];
+        min_key = bucket->elems[0].key;
+        for (unsigned long j = 1; j<bucket->size; ++j) {
+            if (bucket->elems[j].key<min_key) min_key = bucket->elems[j].key;
+        }
+        return min_key/RADIX_SCALE;
+    }
+    return queue->heap[0].key;
+}
+
+unsigned long queue_pop(PriorityQueue* queue)
+{
+    // removes and returns the node index with the lowest fscore, its key is kept in popped_key
+    // the queue must not be empty
+
+    unsigned long index;
+
+    queue->size--;
+    queue->pops++;
+    if (queue->type==SORTED_LIST) {
+        index = queue->list->index;
+        queue->popped_key = queue->list->key;
+        remove_element_from_list(queue, index);
+        return index;
+    }
+    if (queue->type==RADIX_HEAP) {
+        index = radix_pop(queue);
+        queue->popped_key = queue->last_key/RADIX_SCALE;
+        return index;
+    }
+
+    index = queue->heap[0].index;
+    queue->popped_key = queue->heap[0].key;
+    if (queue->size>0) {
+        queue->heap[0] = queue->heap[queue->size];
+        heap_sift_down(queue, 0);
+    }
+    return index;
+}
+
+bool parse_queue_type(const char* name, QueueType* queue_type)
+{
+    // converts the name of a queue implementation (heap, list or radix) into a QueueType
+    // returns false if the name is unknown
+
+    if (strcmp(name, "heap")==0) *queue_type = DARY_HEAP;
+    else if (strcmp(name, "list")==0) *queue_type = SORTED_LIST;
+    else if (strcmp(name, "radix")==0) *queue_type = RADIX_HEAP;
+    else return false;
+    return true;
+}
@@ -0,0 +1,495 @@
+// server.c
+// answers routing requests of local clients over a unix domain socket or a localhost TCP port
+// the graph is loaded once, a pool of worker threads answers the requests, each worker with its own query handle
+// part of the command line tool, it only uses the library interface of libastar.h
+//
+// protocol: one request per line, either "source_node_id goal_node_id" or {"source":id,"goal":id},
+// every request is answered by one line of JSON:
+//      {"source":id,"goal":id,"status":0,"length":metres,"nr_of_nodes":n,"nodes":[ids],"distances":[metres]}
+//      {"source":id,"goal":id,"status":code,"error":"message"}
+// the status codes are the exit codes of the command line tool, a connection may send any number of requests
+// with -s every answer also has the statistics of its route, as "stats":{...} before the closing brace
+// a line longer than SERVER_LINE_LIMIT bytes is answered with {"status":1,"error":...} and the connection is closed
+//
+// run_server polls the listener and all connections which wait for a request, a connection with one goes into
+// the ready ring, a worker answers one request of it and gives it back, so a slow or idle client never keeps a
+// worker from the others, and a connection without a request for SERVER_IDLE_TIMEOUT seconds is closed
+
+
+#include "astar.h"
+
+static volatile sig_atomic_t stop_requested = 0;
+static int wake_pipe[2] = {-1, -1}; // the signal handler and the workers write to wake_pipe[1] to wake up run_server
+
+static void wake_server(void)
+{
+    int saved_errno = errno;
+
+    if (write(wake_pipe[1], "", 1)==-1) {
+        // the pipe is full, run_server is woken up already
+    }
+    errno = saved_errno;
+}
+
+static void request_stop(int signal_number)
+{
+    (void) signal_number;
+    stop_requested = 1;
+    wake_server();
+}
+
+static time_t monotonic_seconds(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec;
+}
+
+static bool parse_request(const char* line, unsigned long* source, unsigned long* goal)
+{
+    // reads the two node ids of a request line, plain or as a JSON object
+    const char* key;
+
+    if (line[strspn(line, " \t")]!='{') return sscanf(line, "%lu %lu", source, goal)==2;
+    if ((key = strstr(line, "\"source\""))==NULL || (key = strchr(key, ':'))==NULL) return false;
+    *source = strtoul(key+1, NULL, 10);
+    if ((key = strstr(line, "\"goal\""))==NULL || (key = strchr(key, ':'))==NULL) return false;
+    *goal = strtoul(key+1, NULL, 10);
+    return true;
+}
+
+static bool send_all(int client, const char* data, size_t size)
+{
+    ssize_t sent;
+
+    while (size>0) {
+        if ((sent = send(client, data, size, MSG_NOSIGNAL))<=0) return false;
+        data += sent;
+        size -= (size_t) sent;
+    }
+    return true;
+}
+
+static void append(char** buffer, size_t* capacity, size_t* length, const char* text, size_t size)
+{
+    // appends to a growable response buffer, it keeps room for the terminating zero of astar_format_path
+    if (*length+size+1>*capacity) {
+        *capacity = *capacity==0 ? 4096 : *capacity;
+        while (*length+size+1>*capacity) *capacity *= 2;
+        if ((*buffer = realloc(*buffer, *capacity))==NULL) exit(1);
+    }
+    memcpy(*buffer+*length, text, size);
+    *length += size;
+}
+
+static void append_text(char** buffer, size_t* capacity, size_t* length, const char* text)
+{
+    append(buffer, capacity, length, text, strlen(text));
+}
+
+static size_t format_response(char** buffer, size_t* capacity, unsigned long source, unsigned long goal,
+        AStarCode code, AStarPath* path, AStarQuery* query, StatsOutput stats_output)
+{
+    // formats the answer of one request into the buffer, the route is the JSON of astar_format_path without its
+    // braces, returns the length of the answer
+
+    AStarStats stats;
+    char text[STATS_LINE_SIZE];
+    size_t length = 0;
+    size_t path_length;
+
+    snprintf(text, sizeof(text), "{\"source\":%lu,\"goal\":%lu,\"status\":%d,", source, goal, code);
+    append_text(buffer, capacity, &length, text);
+    if (code!=ASTAR_OK) {
+        append_text(buffer, capacity, &length, "\"error\":\"");
+        append_text(buffer, capacity, &length, astar_code_message(code));
+        append_text(buffer, capacity, &length, "\"");
+    }
+    else {
+        // {"length":...]}\n is formatted again into a larger buffer if it does not fit, then the braces are cut off
+        path_length = astar_format_path(path, ASTAR_PATH_JSON, *buffer+length, *capacity-length);
+        if (path_length>=*capacity-length) {
+            append(buffer, capacity, &length, "", path_length);
+            length -= path_length;
+            astar_format_path(path, ASTAR_PATH_JSON, *buffer+length, *capacity-length);
+        }
+        memmove(*buffer+length, *buffer+length+1, path_length-3);
+        length += path_length-3;
+    }
+    if (stats_output!=NO_STATS) {
+        // always JSON here, the answer is JSON
+        astar_query_stats(query, &stats);
+        append_text(buffer, capacity, &length, ",\"stats\":");
+        astar_format_stats(&stats, true, text, sizeof(text));
+        append_text(buffer, capacity, &length, text);
+    }
+    append_text(buffer, capacity, &length, "}\n");
+    return length;
+}
+
+static bool answer_request(int client, char* line, AStarQuery* query, StatsOutput stats_output, char** response,
+        size_t* capacity)
+{
+    // routes one request line and sends its answer right away, empty lines are skipped
+    // returns false if the answer can not be sent
+    static const char malformed[] = "{\"status\":1,\"error\":\"Expected: source_node_id goal_node_id\"}\n";
+    unsigned long source, goal;
+    AStarPath path;
+    AStarCode code;
+
+    if (line[strspn(line, " \t\r")]=='\0') return true;
+    if (!parse_request(line, &source, &goal)) return send_all(client, malformed, sizeof(malformed)-1);
+    code = astar_route(query, source, goal, &path);
+    return send_all(client, *response,
+            format_response(response, capacity, source, goal, code, &path, query, stats_output));
+}
+
+static ConnectionState serve_request(ServerConnection* connection, AStarQuery* query, StatsOutput stats_output,
+        char** response, size_t* capacity)
+{
+    // answers the next request of the connection, what is already received first, otherwise what one recv
+    // returns (the connection was polled readable, the recv does not wait)
+    // returns the state the connection goes to: CONNECTION_QUEUED if another complete request is waiting,
+    // CONNECTION_IDLE to wait for more, CONNECTION_CLOSING after a too long line or CONNECTION_FREE to close it
+
+    static const char too_long[] = "{\"status\":1,\"error\":\"The request line is too long.\"}\n";
+    char* line_end = memchr(connection->input, '\n', connection->used);
+    ssize_t received;
+    size_t line_length;
+
+    if (line_end==NULL) {
+        if (connection->used==connection->capacity) {
+            connection->capacity = connection->capacity==0 ? 4096 : 2*connection->capacity;
+            if (connection->capacity>SERVER_LINE_LIMIT) connection->capacity = SERVER_LINE_LIMIT;
+            if ((connection->input = realloc(connection->input, connection->capacity+1))==NULL) exit(1);
+        }
+        received = recv(connection->socket, connection->input+connection->used,
+                connection->capacity-connection->used, MSG_DONTWAIT);
+        if (received==0) {
+            // a last request without a line end
+            connection->input[connection->used] = '\0';
+            answer_request(connection->socket, connection->input, query, stats_output, response, capacity);
+            return CONNECTION_FREE;
+        }
+        if (received<0) return errno==EAGAIN || errno==EWOULDBLOCK || errno==EINTR ? CONNECTION_IDLE : CONNECTION_FREE;
+        connection->used += (size_t) received;
+        connection->last_active = monotonic_seconds();
+        if ((line_end = memchr(connection->input, '\n', connection->used))==NULL) {
+            if (connection->used<SERVER_LINE_LIMIT) return CONNECTION_IDLE;
+            if (!send_all(connection->socket, too_long, sizeof(too_long)-1)) return CONNECTION_FREE;
+            shutdown(connection->socket, SHUT_WR);
+            return CONNECTION_CLOSING;
+        }
+    }
+
+    *line_end = '\0';
+    line_length = (size_t) (line_end-connection->input)+1;
+    if (!answer_request(connection->socket, connection->input, query, stats_output, response, capacity))
+        return CONNECTION_FREE;
+    connection->used -= line_length;
+    memmove(connection->input, connection->input+line_length, connection->used);
+    return memchr(connection->input, '\n', connection->used)!=NULL ? CONNECTION_QUEUED : CONNECTION_IDLE;
+}
+
+static void close_connection(ServerConnection* connection)
+{
+    close(connection->socket);
+    free(connection->input);
+    memset(connection, 0, sizeof(ServerConnection));
+    connection->state = CONNECTION_FREE;
+}
+
+static void push_ready(ServerContext* server, unsigned long slot)
+{
+    // queues a connection with a request for the workers, the lock is held
+    server->connections[slot].state = CONNECTION_QUEUED;
+    server->ready[(server->first_ready+server->nr_of_ready)%SERVER_MAX_CONNECTIONS] = slot;
+    server->nr_of_ready++;
+    pthread_cond_signal(&server->connection_ready);
+}
+
+static void* server_worker(void* argument)
+{
+    // answers one request of the next ready connection at a time and gives the connection back, until the server
+    // stops
+
+    ServerContext* server = argument;
+    unsigned long worker = __sync_fetch_and_add(&server->next_worker, 1);
+    ServerConnection* connection;
+    ConnectionState state;
+    unsigned long slot;
+    char* response = NULL;
+    size_t capacity = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&server->lock);
+        while (server->nr_of_ready==0 && !server->stopping) {
+            pthread_cond_wait(&server->connection_ready, &server->lock);
+        }
+        if (server->stopping) {
+            pthread_mutex_unlock(&server->lock);
+            free(response);
+            return NULL;
+        }
+        slot = server->ready[server->first_ready];
+        server->first_ready = (server->first_ready+1)%SERVER_MAX_CONNECTIONS;
+        server->nr_of_ready--;
+        connection = &server->connections[slot];
+        connection->state = CONNECTION_BUSY;
+        pthread_mutex_unlock(&server->lock);
+
+        state = serve_request(connection, server->routers[worker], server->stats_output, &response, &capacity);
+
+        // the connection is closed under the lock, so run_server never shuts down a reused descriptor
+        pthread_mutex_lock(&server->lock);
+        if (state==CONNECTION_FREE) {
+            close_connection(connection);
+        }
+        else if (state==CONNECTION_QUEUED) {
+            push_ready(server, slot);
+        }
+        else {
+            connection->state = state;
+            wake_server(); // to poll the connection again
+        }
+        pthread_mutex_unlock(&server->lock);
+    }
+}
+
+static void drop_input(ServerConnection* connection)
+{
+    // reads what a closing connection sent and drops it, the connection is closed at its end or after
+    // SERVER_LINE_LIMIT more bytes, a close with unread input would reset it before the client read the answer
+    ssize_t received = recv(connection->socket, connection->input, connection->capacity, MSG_DONTWAIT);
+
+    if (received>0) connection->dropped += (size_t) received;
+    if ((received<0 && errno!=EAGAIN && errno!=EWOULDBLOCK && errno!=EINTR) || received==0 ||
+            connection->dropped>SERVER_LINE_LIMIT)
+        close_connection(connection);
+}
+
+static void accept_connections(ServerContext* server, int listener)
+{
+    // accepts all waiting connections into free slots, the others are closed right away
+    // a send blocks at most SERVER_IDLE_TIMEOUT seconds, then the connection is closed
+    struct timeval send_timeout = {.tv_sec=SERVER_IDLE_TIMEOUT, .tv_usec=0};
+    unsigned long slot;
+    int client;
+
+    while ((client = accept(listener, NULL, NULL))!=-1) {
+        pthread_mutex_lock(&server->lock);
+        for (slot = 0; slot<SERVER_MAX_CONNECTIONS && server->connections[slot].state!=CONNECTION_FREE; ++slot) {}
+        if (slot<SERVER_MAX_CONNECTIONS) {
+            setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
+            server->connections[slot].socket = client;
+            server->connections[slot].state = CONNECTION_IDLE;
+            server->connections[slot].last_active = monotonic_seconds();
+            client = -1;
+        }
+        pthread_mutex_unlock(&server->lock);
+        if (client!=-1) close(client);
+    }
+}
+
+static int open_listener(const char* address)
+{
+    // a unix domain socket if the address is a path (contains a '/'), otherwise a TCP port on 127.0.0.1
+    // a stale socket file of an earlier server is replaced, any other file at the path is left alone and the
+    // address counts as in use
+    // returns the listening socket or -1
+
+    struct sockaddr_un unix_address;
+    struct sockaddr_in tcp_address;
+    struct stat file_status;
+    int listener;
+    int reuse = 1;
+
+    if (strchr(address, '/')!=NULL) {
+        if (strlen(address)>=sizeof(unix_address.sun_path)) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        memset(&unix_address, 0, sizeof(unix_address));
+        unix_address.sun_family = AF_UNIX;
+        strcpy(unix_address.sun_path, address);
+        if (lstat(address, &file_status)==0) {
+            if (!S_ISSOCK(file_status.st_mode)) {
+                errno = EADDRINUSE;
+                return -1;
+            }
+            unlink(address);
+        }
+        if ((listener = socket(AF_UNIX, SOCK_STREAM, 0))==-1) return -1;
+        if (bind(listener, (struct sockaddr*) &unix_address, sizeof(unix_address))==-1) {
+            close(listener);
+            return -1;
+        }
+    }
+    else {
+        memset(&tcp_address, 0, sizeof(tcp_address));
+        tcp_address.sin_family = AF_INET;
+        tcp_address.sin_port = htons((uint16_t) strtoul(address, NULL, 10));
+        tcp_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if ((listener = socket(AF_INET, SOCK_STREAM, 0))==-1) return -1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (bind(listener, (struct sockaddr*) &tcp_address, sizeof(tcp_address))==-1) {
+            close(listener);
+            return -1;
+        }
+    }
+    if (listen(listener, SERVER_BACKLOG)==-1) {
+        close(listener);
+        return -1;
+    }
+    return listener;
+}
+
+AStarCode run_server(const char* address, AStarGraph* graph, const AStarOptions* options, unsigned int nr_of_threads,
+        StatsOutput stats_output)
+{
+    // serves the graph on address (see open_listener) with nr_of_threads workers until SIGINT or SIGTERM
+    // polls the listener, the wake pipe and the connections which wait for a request, the pipe wakes it up on
+    // a signal (which is then not lost between the check of stop_requested and the poll) and when a worker gives
+    // back a connection
+    // at the end the connections are shut down and the workers joined, so the graph can be closed afterwards
+    // returns the code of astar_query_create, or ASTAR_FAILURE if the address can not be listened on or no worker
+    // can be started
+
+    ServerContext* server;
+    pthread_t* threads;
+    struct sigaction action;
+    sigset_t stop_signals;
+    struct pollfd waiting[2+SERVER_MAX_CONNECTIONS];
+    unsigned long polled[SERVER_MAX_CONNECTIONS];
+    unsigned long nr_of_polled;
+    ServerConnection* connection;
+    char drained[64];
+    time_t now, deadline;
+    int timeout;
+    int listener = -1;
+    int error = 0;
+    unsigned int nr_of_workers = 0;
+    AStarCode code = ASTAR_OK;
+
+    server = calloc(1, sizeof(ServerContext));
+    threads = malloc(nr_of_threads*sizeof(pthread_t));
+    if (server==NULL || threads==NULL) exit(1);
+    server->stats_output = stats_output;
+    server->routers = calloc(nr_of_threads, sizeof(AStarQuery*));
+    if (server->routers==NULL) exit(1);
+    for (unsigned int i = 0; i<nr_of_threads && code==ASTAR_OK; ++i) {
+        code = astar_query_create(graph, options, &server->routers[i]);
+    }
+    if (code==ASTAR_OK && (listener = open_listener(address))==-1) {
+        fprintf(stderr, "Can not listen on %s: %s\n", address, strerror(errno));
+        code = ASTAR_FAILURE;
+    }
+    // the listener does not block either, a connection given up between poll and accept must not hang the loop
+    if (code==ASTAR_OK && (pipe(wake_pipe)==-1 || fcntl(wake_pipe[0], F_SETFL, O_NONBLOCK)==-1 ||
+            fcntl(wake_pipe[1], F_SETFL, O_NONBLOCK)==-1 || fcntl(listener, F_SETFL, O_NONBLOCK)==-1)) {
+        fprintf(stderr, "Can not create the wake pipe: %s\n", strerror(errno));
+        close(listener);
+        code = ASTAR_FAILURE;
+    }
+    if (code!=ASTAR_OK) {
+        for (unsigned int i = 0; i<nr_of_threads; ++i) astar_query_free(server->routers[i]);
+        free(server->routers);
+        free(server);
+        free(threads);
+        return code;
+    }
+
+    // the workers block the signals so they reach this thread, where they interrupt poll or make it return
+    // through the pipe (the answers are sent with MSG_NOSIGNAL, a client closing early does not raise SIGPIPE)
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = request_stop;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+
+    pthread_mutex_init(&server->lock, NULL);
+    pthread_cond_init(&server->connection_ready, NULL);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, NULL);
+    // the server runs with the workers which could be started, without any it stops right away
+    while (nr_of_workers<nr_of_threads &&
+            (error = pthread_create(&threads[nr_of_workers], NULL, server_worker, server))==0) {
+        nr_of_workers++;
+    }
+    pthread_sigmask(SIG_UNBLOCK, &stop_signals, NULL);
+    if (nr_of_workers==0) {
+        fprintf(stderr, "Can not start the workers: %s\n", strerror(error));
+        code = ASTAR_FAILURE;
+    }
+    else {
+        fprintf(stderr, "Listening on %s with %u worker(s).\n", address, nr_of_workers);
+    }
+
+    waiting[0] = (struct pollfd) {.fd=listener, .events=POLLIN};
+    waiting[1] = (struct pollfd) {.fd=wake_pipe[0], .events=POLLIN};
+    while (code==ASTAR_OK && !stop_requested) {
+        // the connections waiting for a request and the time until the first of them times out
+        now = monotonic_seconds();
+        timeout = -1;
+        nr_of_polled = 0;
+        pthread_mutex_lock(&server->lock);
+        for (unsigned long i = 0; i<SERVER_MAX_CONNECTIONS; ++i) {
+            connection = &server->connections[i];
+            if (connection->state!=CONNECTION_IDLE && connection->state!=CONNECTION_CLOSING) continue;
+            deadline = connection->last_active+SERVER_IDLE_TIMEOUT;
+            if (deadline<=now) {
+                close_connection(connection);
+                continue;
+            }
+            if (timeout==-1 || (deadline-now)*1000<timeout) timeout = (int) (deadline-now)*1000;
+            waiting[2+nr_of_polled] = (struct pollfd) {.fd=connection->socket, .events=POLLIN};
+            polled[nr_of_polled++] = i;
+        }
+        pthread_mutex_unlock(&server->lock);
+
+        if (poll(waiting, 2+nr_of_polled, timeout)==-1) continue; // EINTR on a stop signal
+        if (waiting[1].revents & POLLIN) {
+            while (read(wake_pipe[0], drained, sizeof(drained))>0) {}
+        }
+        pthread_mutex_lock(&server->lock);
+        for (unsigned long i = 0; i<nr_of_polled; ++i) {
+            if (waiting[2+i].revents==0) continue;
+            if (server->connections[polled[i]].state==CONNECTION_IDLE) push_ready(server, polled[i]);
+            else drop_input(&server->connections[polled[i]]);
+        }
+        pthread_mutex_unlock(&server->lock);
+        if (waiting[0].revents & POLLIN) accept_connections(server, listener);
+    }
+
+    close(listener);
+    if (strchr(address, '/')!=NULL) unlink(address);
+    pthread_mutex_lock(&server->lock);
+    server->stopping = true;
+    for (unsigned long i = 0; i<SERVER_MAX_CONNECTIONS; ++i) {
+        if (server->connections[i].state==CONNECTION_BUSY) shutdown(server->connections[i].socket, SHUT_RDWR);
+    }
+    pthread_cond_broadcast(&server->connection_ready);
+    pthread_mutex_unlock(&server->lock);
+    for (unsigned int i = 0; i<nr_of_workers; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    // only now, the workers write to it until they are joined
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
+    wake_pipe[0] = wake_pipe[1] = -1;
+    for (unsigned long i = 0; i<SERVER_MAX_CONNECTIONS; ++i) {
+        if (server->connections[i].state!=CONNECTION_FREE) close_connection(&server->connections[i]);
+    }
+    fprintf(stderr, "Server stopped.\n");
+
+    pthread_mutex_destroy(&server->lock);
+    pthread_cond_destroy(&server->connection_ready);
+    for (unsigned int i = 0; i<nr_of_threads; ++i) astar_query_free(server->routers[i]);
+    free(server->routers);
+    free(server);
+    free(threads);
+    return code;
+}
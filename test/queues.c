@@ -0,0 +1,115 @@
+// queues.c
+// checks the three OPEN set implementations on the same known sequence of operations
+//
+// usage: ./test_queues
+//
+// pushes, decrease-keys and pops are mixed like in a Dijkstra search: the keys never fall below the key popped
+// last, so the radix heap can take them as well, and every pop and the queue_min_key before it are compared with
+// the node of the smallest key which a plain array of the current keys gives; the keys are whole millimetres and
+// differ by the index of their node, so there are no ties and every queue has to pop exactly the same sequence
+// exits with 1 and reports the first difference of every queue if a queue pops another node or key
+
+
+#include "../src/astar.h"
+
+#define TEST_NODES 1000
+#define TEST_ROUNDS 2 // the queue is cleared and used again, like the queue of a search workspace
+
+static uint64_t next_random(uint64_t* state)
+{
+    // xorshift64, fixed seed so every run does the same operations
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static double node_key(unsigned long value, unsigned long index)
+{
+    // a key in metres of value whole metres plus index millimetres, unique while every node has one key
+    return (value*1024+index)/1000.0;
+}
+
+static bool same_key(double a, double b)
+{
+    // the heap keeps its keys as floats, half a millimetre is well above their rounding at these keys
+    return fabs(a-b)<0.0005;
+}
+
+static unsigned long check_queue(QueueType type, const char* name)
+{
+    // runs the operations on a queue of type and returns the number of differences to the expected sequence
+
+    PriorityQueue queue;
+    uint64_t state = 88172645463325252ULL;
+    unsigned long value[TEST_NODES]; // current key of every node in the queue, in whole metres
+    bool queued[TEST_NODES];
+    unsigned long nr_of_pushed, nr_of_queued, last_value, index, min_index, popped, operation;
+    unsigned long nr_of_pops = 0, nr_of_errors = 0;
+
+    queue_init(&queue, type, TEST_NODES);
+    for (int round = 0; round<TEST_ROUNDS; ++round) {
+        memset(queued, 0, sizeof(queued));
+        nr_of_pushed = nr_of_queued = last_value = 0;
+        queue_clear(&queue);
+
+        while (nr_of_pushed<TEST_NODES || nr_of_queued>0) {
+            operation = next_random(&state)%10;
+            if (nr_of_pushed<TEST_NODES && (nr_of_queued==0 || operation<4)) {
+                // a newly reached node, a bit farther than the node popped last
+                index = nr_of_pushed++;
+                value[index] = last_value+1+next_random(&state)%200;
+                queued[index] = true;
+                nr_of_queued++;
+                queue_push(&queue, index, node_key(value[index], index));
+            }
+            else if (operation<7) {
+                // a shorter path to a node in the queue, if there is room above the last popped key
+                do index = next_random(&state)%nr_of_pushed; while (!queued[index]);
+                if (!same_key(queue_key(&queue, index), node_key(value[index], index)) && nr_of_errors++==0) {
+                    printf("%s: key %.3f of node %lu instead of %.3f\n", name, queue_key(&queue, index), index,
+                            node_key(value[index], index));
+                }
+                if (value[index]>last_value+1) {
+                    value[index] = last_value+1+next_random(&state)%(value[index]-last_value-1);
+                    queue_decrease_key(&queue, index, node_key(value[index], index));
+                }
+            }
+            else {
+                min_index = TEST_NODES;
+                for (index = 0; index<nr_of_pushed; ++index) {
+                    if (queued[index] && (min_index==TEST_NODES || node_key(value[index], index)<
+                            node_key(value[min_index], min_index))) min_index = index;
+                }
+                if (!same_key(queue_min_key(&queue), node_key(value[min_index], min_index)) && nr_of_errors++==0) {
+                    printf("%s: lowest key %.3f instead of %.3f\n", name, queue_min_key(&queue),
+                            node_key(value[min_index], min_index));
+                }
+                popped = queue_pop(&queue);
+                if ((popped!=min_index || !same_key(queue.popped_key, node_key(value[min_index], min_index))) &&
+                        nr_of_errors++==0) {
+                    printf("%s: pop %lu gave node %lu with key %.3f instead of node %lu with key %.3f\n", name,
+                            nr_of_pops, popped, queue.popped_key, min_index, node_key(value[min_index], min_index));
+                }
+                queued[min_index] = false;
+                nr_of_queued--;
+                last_value = value[min_index];
+                nr_of_pops++;
+            }
+        }
+        if (!queue_is_empty(&queue) && nr_of_errors++==0) printf("%s: not empty after the last pop\n", name);
+    }
+    queue_free(&queue);
+    printf("%-5s %lu pops, %lu difference(s)\n", name, nr_of_pops, nr_of_errors);
+    return nr_of_errors;
+}
+
+int main(void)
+{
+    unsigned long nr_of_errors = 0;
+
+    nr_of_errors += check_queue(DARY_HEAP, "heap");
+    nr_of_errors += check_queue(SORTED_LIST, "list");
+    nr_of_errors += check_queue(RADIX_HEAP, "radix");
+    return nr_of_errors>0;
+}
@@ -0,0 +1,197 @@
+// routes.c
+// checks every search of the router against the unidirectional A* on a .csv, usually one of bench_generate
+//
+// usage: ./test_routes /path/to/my/file.csv
+//
+// writes file.bin, file.alt and file.ch next to the .csv, then routes between fixed pairs of nodes with A* and
+// compares the lengths of the bidirectional search, the landmark heuristic, the contraction hierarchy and the
+// other queues with them, as well as the distances of the distance matrix and of the isochrones; a pair without
+// a route has to have none in every search
+// exits with 1 and reports the first mismatches if any distance differs by more than the float rounding of g
+
+
+#include "../src/astar.h"
+
+#define TEST_LANDMARKS 8
+#define TEST_SOURCES 8
+#define TEST_TARGETS 64
+#define TEST_THREADS 2
+#define TEST_REPORTED 5 // mismatches reported per check, the others are only counted
+
+static uint64_t next_random(uint64_t* state)
+{
+    // xorshift64, fixed seed so every run checks the same pairs
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static int compare_ids(const void* a, const void* b)
+{
+    uint64_t id_a = *(const uint64_t*) a;
+    uint64_t id_b = *(const uint64_t*) b;
+    return (id_a>id_b)-(id_a<id_b);
+}
+
+static void check(AStarCode code, const char* step)
+{
+    if (code==ASTAR_OK) return;
+    fprintf(stderr, "%s: %s\n", step, astar_code_message(code));
+    exit(code);
+}
+
+static bool same_distance(double distance, double expected)
+{
+    // -1 for no route, else equal up to the rounding of the float g along different paths of the same length
+    if (distance<0 || expected<0) return distance<0 && expected<0;
+    return fabs(distance-expected)<=0.01+1e-5*expected;
+}
+
+static unsigned long compare(const char* name, const double* distances, const double* expected, uint64_t* pairs,
+        unsigned long nr_of_pairs)
+{
+    // prints the result of a check and its first mismatches, returns the number of mismatches
+
+    unsigned long nr_of_mismatches = 0;
+
+    for (unsigned long i = 0; i<nr_of_pairs; ++i) {
+        if (same_distance(distances[i], expected[i])) continue;
+        if (nr_of_mismatches++<TEST_REPORTED) {
+            printf("%s: %lu -> %lu is %.2f m instead of %.2f m\n", name, (unsigned long) pairs[2*i],
+                    (unsigned long) pairs[2*i+1], distances[i], expected[i]);
+        }
+    }
+    printf("%-32s %lu distances, %lu mismatch(es)\n", name, nr_of_pairs, nr_of_mismatches);
+    return nr_of_mismatches;
+}
+
+static void route_all(AStarGraph* graph, const AStarOptions* options, uint64_t* pairs, unsigned long nr_of_pairs,
+        double* lengths)
+{
+    // the lengths of the routes between the pairs with one query handle, -1 for a pair without a route
+
+    AStarQuery* query;
+    AStarPath path;
+    AStarCode code;
+
+    check(astar_query_create(graph, options, &query), "query");
+    for (unsigned long i = 0; i<nr_of_pairs; ++i) {
+        code = astar_route(query, pairs[2*i], pairs[2*i+1], &path);
+        if (code!=ASTAR_NO_ROUTE) check(code, "route");
+        lengths[i] = code==ASTAR_OK ? path.length : -1;
+    }
+    astar_query_free(query);
+}
+
+static void reach_all(AStarGraph* graph, uint64_t* sources, uint64_t* targets, double max_distance,
+        double* distances)
+{
+    // the distances of the targets in the isochrones of the sources, -1 for a target outside of its isochrone
+
+    AStarQuery* query;
+    AStarReach reach;
+
+    check(astar_query_create(graph, NULL, &query), "query");
+    for (unsigned long s = 0; s<TEST_SOURCES; ++s) {
+        check(astar_isochrone(query, sources[s], max_distance, &reach), "isochrone");
+        for (unsigned long t = 0; t<TEST_TARGETS; ++t) {
+            distances[s*TEST_TARGETS+t] = -1;
+            for (size_t i = 0; i<reach.nr_of_nodes; ++i) {
+                if (reach.ids[i]==targets[t]) distances[s*TEST_TARGETS+t] = reach.distances[i];
+            }
+        }
+    }
+    astar_query_free(query);
+}
+
+int main(int argc, char* argv[])
+{
+    char* csv_filename;
+    char* filename;
+    uint64_t state = 88172645463325252ULL;
+    uint64_t sources[TEST_SOURCES];
+    uint64_t targets[TEST_TARGETS];
+    uint64_t pairs[2*TEST_SOURCES*TEST_TARGETS];
+    double expected[TEST_SOURCES*TEST_TARGETS];
+    double distances[TEST_SOURCES*TEST_TARGETS];
+    double max_distance = 0;
+    uint64_t* sorted_ids;
+    unsigned long nr_of_pairs = TEST_SOURCES*TEST_TARGETS;
+    unsigned long nr_of_mismatches = 0;
+    Graph graph;
+    AStarGraph* handle;
+    AStarOptions side_options = {.algorithm="ch", .heuristic="landmarks", .queue=NULL};
+    const AStarOptions configurations[] = {
+            {"astar", "haversine", "list"},
+            {"astar", "haversine", "radix"},
+            {"astar", "landmarks", "heap"},
+            {"bidirectional", "haversine", "heap"},
+            {"bidirectional", "landmarks", "heap"},
+            {"ch", NULL, "heap"}
+    };
+    char name[64];
+    int code;
+
+    if (argc<2) {
+        printf("Usage: ./test_routes file.csv\n");
+        exit(1);
+    }
+    csv_filename = argv[1];
+    if (strrchr(csv_filename, '.')==NULL) exit(1);
+    if ((filename = malloc(strlen(csv_filename)+5))==NULL) exit(1);
+    strcpy(filename, csv_filename);
+    strcpy(strrchr(filename, '.'), ".bin");
+
+    check(astar_convert(csv_filename, 1, NULL, false), "import");
+    check(astar_build_landmarks(filename, NULL, TEST_LANDMARKS), "landmarks");
+    check(astar_contract(filename, NULL), "contraction");
+
+    // the pairs are chosen by id, the i-th smallest id is the same node in every node order
+    if ((code = read_binary_file(filename, &graph))!=0) exit(code);
+    if ((sorted_ids = malloc(graph.nr_of_nodes*sizeof(uint64_t)))==NULL) exit(1);
+    memcpy(sorted_ids, graph.ids, graph.nr_of_nodes*sizeof(uint64_t));
+    qsort(sorted_ids, graph.nr_of_nodes, sizeof(uint64_t), compare_ids);
+    for (unsigned long s = 0; s<TEST_SOURCES; ++s) sources[s] = sorted_ids[next_random(&state)%graph.nr_of_nodes];
+    for (unsigned long t = 0; t<TEST_TARGETS; ++t) targets[t] = sorted_ids[next_random(&state)%graph.nr_of_nodes];
+    free(sorted_ids);
+    free_graph(&graph);
+    for (unsigned long i = 0; i<nr_of_pairs; ++i) {
+        pairs[2*i] = sources[i/TEST_TARGETS];
+        pairs[2*i+1] = targets[i%TEST_TARGETS];
+    }
+
+    check(astar_open(filename, &side_options, &handle), "load .bin, .alt and .ch");
+    route_all(handle, NULL, pairs, nr_of_pairs, expected);
+    for (unsigned long i = 0; i<nr_of_pairs; ++i) {
+        if (expected[i]>max_distance) max_distance = expected[i];
+    }
+
+    for (size_t c = 0; c<sizeof(configurations)/sizeof(configurations[0]); ++c) {
+        snprintf(name, sizeof(name), "%s %s%s%s", configurations[c].algorithm,
+                configurations[c].heuristic ? configurations[c].heuristic : "",
+                configurations[c].heuristic ? " " : "", configurations[c].queue);
+        route_all(handle, &configurations[c], pairs, nr_of_pairs, distances);
+        nr_of_mismatches += compare(name, distances, expected, pairs, nr_of_pairs);
+    }
+
+    check(astar_distance_matrix(handle, NULL, sources, TEST_SOURCES, targets, TEST_TARGETS, TEST_THREADS,
+            distances), "matrix");
+    nr_of_mismatches += compare("matrix heap", distances, expected, pairs, nr_of_pairs);
+    check(astar_distance_matrix(handle, &(AStarOptions) {NULL, NULL, "radix"}, sources, TEST_SOURCES, targets,
+            TEST_TARGETS, TEST_THREADS, distances), "matrix");
+    nr_of_mismatches += compare("matrix radix", distances, expected, pairs, nr_of_pairs);
+
+    reach_all(handle, sources, targets, DBL_MAX, distances);
+    nr_of_mismatches += compare("isochrone", distances, expected, pairs, nr_of_pairs);
+    // with half the longest route as cutoff the farther targets are outside, those at the cutoff may be either
+    reach_all(handle, sources, targets, max_distance/2, distances);
+    for (unsigned long i = 0; i<nr_of_pairs; ++i) {
+        if (expected[i]>max_distance/2) expected[i] = same_distance(expected[i], max_distance/2) ? distances[i] : -1;
+    }
+    nr_of_mismatches += compare("isochrone with cutoff", distances, expected, pairs, nr_of_pairs);
+
+    astar_close(handle);
+    free(filename);
+    return nr_of_mismatches>0;
+}